@@ -0,0 +1,113 @@
+// Compares json_writer with nlohmann::json::dump() on the /stocks and /orderbook schemas.
+// Build with -DEXCHANGE_BUILD_BENCHMARKS=ON and run ./json-writer-bench [rows] [iterations].
+#include "json.hpp"
+#include "json_writer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<quote> make_quotes(std::size_t rows)
+    {
+        std::vector<quote> quotes(rows);
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            quote &q = quotes[i];
+            q.symbol = "SYM" + std::to_string(i);
+            q.name = q.symbol + ".US";
+            q.open = 50.0 + static_cast<double>(i % 977) * 0.37;
+            q.price = q.open * 1.004;
+            q.change = q.price - q.open;
+            q.percent = q.change / q.open * 100.0;
+        }
+        return quotes;
+    }
+
+    std::vector<order_record> make_orders(std::size_t rows)
+    {
+        std::vector<order_record> orders(rows);
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            order_record &o = orders[i];
+            o.id = static_cast<int>(i + 1);
+            o.user_id = static_cast<int>(i % 311);
+            o.side = i % 2 ? "sell" : "buy";
+            o.price = price_ticks(10000 + static_cast<std::int64_t>(i % 500) * 5);
+            o.amount = qty_lots(static_cast<std::int64_t>(1 + i % 40) * 10000);
+            o.status = "open";
+            o.created_at = "2024-05-17 22:00:09.123456+00";
+        }
+        return orders;
+    }
+
+    // What publish_stocks and orderbook_response did before json_writer: build a DOM, then dump it.
+    std::string dom_quotes(const quote_table &t)
+    {
+        nlohmann::json data = nlohmann::json::array();
+        for (std::size_t row = 0; row < t.size(); ++row)
+            data.push_back({{"symbol", t.symbol(row)}, {"name", t.name[row]}, {"price", t.price[row]}, {"change", t.change[row]}, {"percent", t.percent[row]}});
+        return data.dump();
+    }
+
+    std::string dom_orders(const std::vector<order_record> &orders)
+    {
+        nlohmann::json data = nlohmann::json::array();
+        for (const auto &o : orders)
+            data.push_back({{"id", o.id}, {"user_id", o.user_id}, {"side", o.side}, {"price", decimal_to_double(o.price.units, 2)}, {"amount", decimal_to_double(o.amount.units, 4)}, {"status", o.status}, {"created_at", o.created_at}});
+        return data.dump();
+    }
+
+    template <class F>
+    double run(const char *name, std::size_t rows, std::size_t iterations, F &&serialize)
+    {
+        std::size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            bytes += serialize();
+        auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-16s %8.1f ns/row %8.2f ms/body  (%zu bytes)\n", name, ns / static_cast<double>(rows * iterations),
+                    ns / 1e6 / static_cast<double>(iterations), bytes / iterations);
+        return ns;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    std::size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    auto quotes = make_quotes(rows);
+    auto table = quote_table::build(quotes, symbol_table::with_symbols(nullptr, quotes));
+    auto orders = make_orders(rows);
+    nlohmann::json quotes_dom = nlohmann::json::parse(dom_quotes(table));
+    nlohmann::json orders_dom = nlohmann::json::parse(dom_orders(orders));
+    instrument inst; // 2 price decimals, 4 amount decimals, as make_orders assumes
+    json_writer writer;
+
+    std::printf("%zu rows, %zu iterations\n", rows, iterations);
+    writer.clear();
+    write_quotes(writer, table);
+    // dump()'s grisu2 isn't always shortest, so compare values rather than bytes
+    std::printf("/stocks output %s dump()\n", nlohmann::json::parse(writer.out) == quotes_dom ? "matches" : "DIFFERS from");
+    double q_dom = run("stocks dom+dump", rows, iterations, [&]
+                       { return dom_quotes(table).size(); });
+    double q_dump = run("stocks dump", rows, iterations, [&]
+                        { return quotes_dom.dump().size(); });
+    double q_fast = run("stocks writer", rows, iterations, [&]
+                        { writer.clear(); write_quotes(writer, table); return writer.out.size(); });
+    std::printf("speedup  %.1fx vs dom+dump, %.1fx vs dump\n\n", q_dom / q_fast, q_dump / q_fast);
+
+    writer.clear();
+    write_orders(writer, inst, orders);
+    std::printf("/orderbook output %s dump()\n", nlohmann::json::parse(writer.out) == orders_dom ? "matches" : "DIFFERS from");
+    double o_dom = run("orders dom+dump", rows, iterations, [&]
+                       { return dom_orders(orders).size(); });
+    double o_dump = run("orders dump", rows, iterations, [&]
+                        { return orders_dom.dump().size(); });
+    double o_fast = run("orders writer", rows, iterations, [&]
+                        { writer.clear(); write_orders(writer, inst, orders); return writer.out.size(); });
+    std::printf("speedup  %.1fx vs dom+dump, %.1fx vs dump\n", o_dom / o_fast, o_dump / o_fast);
+    return 0;
+}
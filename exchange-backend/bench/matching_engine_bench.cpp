@@ -0,0 +1,100 @@
+// Throughput of matching_engine on a synthetic flow: mostly passive limit orders around a mid
+// price, some that cross, some market orders and a steady stream of cancels. Also reports the
+// latency distribution per command, where allocator churn shows up first.
+// Build with -DEXCHANGE_BUILD_BENCHMARKS=ON and run ./matching-engine-bench [commands].
+#include "matching_engine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    struct command
+    {
+        bool cancel = false;
+        order_request order;
+    };
+
+    // xorshift64*, so every run sees the same flow
+    struct rng
+    {
+        std::uint64_t state = 0x9e3779b97f4a7c15ull;
+
+        std::uint32_t next(std::uint32_t bound)
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<std::uint32_t>(((state * 0x2545f4914f6cdd1dull) >> 32) % bound);
+        }
+    };
+
+    std::vector<command> make_flow(std::size_t n)
+    {
+        std::vector<command> flow(n);
+        rng r;
+        int next_id = 1;
+        for (auto &c : flow)
+        {
+            std::uint32_t kind = r.next(100);
+            if (kind < 30 && next_id > 1)
+            {
+                c.cancel = true;
+                c.order.id = next_id - 1 - static_cast<int>(r.next(static_cast<std::uint32_t>(std::min(next_id - 1, 5000))));
+                continue;
+            }
+            order_request &o = c.order;
+            o.id = next_id++;
+            o.user_id = static_cast<int>(r.next(1000));
+            o.side = r.next(2) ? order_side::buy : order_side::sell;
+            o.amount = qty_lots(1 + r.next(20));
+            if (kind < 40)
+            {
+                o.type = order_type::market;
+                continue;
+            }
+            // passive orders up to 50 ticks away from the 100.00 mid; one in ten crosses by a few ticks
+            int ticks = r.next(10) == 0 ? -static_cast<int>(r.next(5)) : 1 + static_cast<int>(r.next(50));
+            int offset = o.side == order_side::buy ? -ticks : ticks;
+            o.price = price_ticks(10000 + offset);
+        }
+        return flow;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    auto flow = make_flow(n);
+    matching_engine engine;
+    std::size_t fills = 0;
+    std::size_t rejected = 0;
+    std::vector<std::int64_t> latency(n);
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const command &c = flow[i];
+        const match_result &r = c.cancel ? engine.cancel(c.order.id) : engine.submit(c.order);
+        fills += r.fills.size();
+        rejected += !r.accepted;
+        auto now = std::chrono::steady_clock::now();
+        latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        last = now;
+    }
+    double secs = std::chrono::duration<double>(last - start).count();
+    std::printf("%zu commands in %.3f s: %.2f M commands/s, %.1f ns/command\n", n, secs, static_cast<double>(n) / secs / 1e6,
+                secs * 1e9 / static_cast<double>(n));
+    std::printf("%zu fills, %zu rejected (mostly cancels of orders already gone), %zu resting at the end\n", fills, rejected,
+                engine.book().size());
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p)
+    { return latency[std::min(n - 1, static_cast<std::size_t>(p * static_cast<double>(n)))]; };
+    std::printf("latency ns (including clock reads): p50 %lld, p99 %lld, p99.9 %lld, p99.99 %lld, max %lld\n",
+                static_cast<long long>(pct(0.5)), static_cast<long long>(pct(0.99)), static_cast<long long>(pct(0.999)),
+                static_cast<long long>(pct(0.9999)), static_cast<long long>(latency[n - 1]));
+    return 0;
+}
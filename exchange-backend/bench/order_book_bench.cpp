@@ -0,0 +1,343 @@
+// order_book's tick ladder against the std::map<double, level> book it replaced, on the same
+// synthetic flow: passive orders clustered around the touch, cancels of recent orders, takers
+// that sweep a few levels, and a top-10 depth read every so often the way /orderbook publishes.
+// Build with -DEXCHANGE_BUILD_BENCHMARKS=ON and run ./order-book-bench [operations].
+#include "order_book.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // Prices and amounts as the previous book held them: doubles, as read from Postgres.
+    struct map_order
+    {
+        int id = 0;
+        int user_id = 0;
+        order_side side = order_side::buy;
+        double price = 0;
+        double amount = 0;
+    };
+
+    struct map_level_view
+    {
+        double price = 0;
+        double amount = 0;
+        std::size_t orders = 0;
+    };
+
+    double to_double(price_ticks p)
+    {
+        return decimal_to_double(p.units, 2);
+    }
+
+    double to_double(qty_lots q)
+    {
+        return static_cast<double>(q.units);
+    }
+
+    double to_double(double v)
+    {
+        return v;
+    }
+
+    // The previous order_book: a sorted map of levels per side keyed by the double price. Takes
+    // the flow's book_orders and converts them, as its callers used to from the database rows.
+    class map_book
+    {
+    public:
+        bool add(const book_order &b)
+        {
+            map_order o{b.id, b.user_id, b.side, to_double(b.price), to_double(b.amount)};
+            if (!(o.amount > 0) || index_.count(o.id))
+                return false;
+            level &l = o.side == order_side::buy ? bids_[o.price] : asks_[o.price];
+            l.amount += o.amount;
+            l.orders.push_back(o);
+            index_.emplace(o.id, locator{o.side, o.price, std::prev(l.orders.end())});
+            return true;
+        }
+
+        std::optional<map_order> cancel(int id)
+        {
+            auto it = index_.find(id);
+            if (it == index_.end())
+                return std::nullopt;
+            locator loc = it->second;
+            index_.erase(it);
+            map_order removed = *loc.node;
+            auto remove = [&](auto &levels)
+            {
+                auto lv = levels.find(loc.price);
+                lv->second.amount -= removed.amount;
+                lv->second.orders.erase(loc.node);
+                if (lv->second.orders.empty())
+                    levels.erase(lv);
+            };
+            if (loc.side == order_side::buy)
+                remove(bids_);
+            else
+                remove(asks_);
+            return removed;
+        }
+
+        template <class OnFill>
+        double match(order_side taker, price_ticks limit_ticks, qty_lots lots, OnFill &&on_fill)
+        {
+            std::optional<double> limit = to_double(limit_ticks);
+            double amount = to_double(lots);
+            if (taker == order_side::buy)
+                return match_levels(asks_, [&](double price)
+                                    { return !limit || price <= *limit; }, amount, on_fill);
+            return match_levels(bids_, [&](double price)
+                                { return !limit || price >= *limit; }, amount, on_fill);
+        }
+
+        std::vector<map_level_view> bids(std::size_t depth) const
+        {
+            return view(bids_, depth);
+        }
+
+        std::vector<map_level_view> asks(std::size_t depth) const
+        {
+            return view(asks_, depth);
+        }
+
+        std::size_t size() const
+        {
+            return index_.size();
+        }
+
+    private:
+        struct level
+        {
+            double amount = 0;
+            std::list<map_order> orders;
+        };
+
+        struct locator
+        {
+            order_side side;
+            double price;
+            std::list<map_order>::iterator node;
+        };
+
+        template <class Levels>
+        static std::vector<map_level_view> view(const Levels &levels, std::size_t depth)
+        {
+            std::vector<map_level_view> out;
+            out.reserve(std::min(depth, levels.size()));
+            for (auto it = levels.begin(); it != levels.end() && out.size() < depth; ++it)
+                out.push_back({it->first, it->second.amount, it->second.orders.size()});
+            return out;
+        }
+
+        template <class Levels, class Crosses, class OnFill>
+        double match_levels(Levels &levels, Crosses &&crosses, double amount, OnFill &on_fill)
+        {
+            while (amount > 0 && !levels.empty() && crosses(levels.begin()->first))
+            {
+                auto lv = levels.begin();
+                level &l = lv->second;
+                while (amount > 0 && !l.orders.empty())
+                {
+                    map_order &maker = l.orders.front();
+                    double traded = std::min(amount, maker.amount);
+                    on_fill(static_cast<const map_order &>(maker), traded);
+                    amount -= traded;
+                    maker.amount -= traded;
+                    l.amount -= traded;
+                    if (maker.amount <= 0)
+                    {
+                        index_.erase(maker.id);
+                        l.orders.pop_front();
+                    }
+                }
+                if (l.orders.empty())
+                    levels.erase(lv);
+            }
+            return amount;
+        }
+
+        std::map<double, level, std::greater<double>> bids_;
+        std::map<double, level> asks_;
+        std::unordered_map<int, locator> index_;
+    };
+
+    enum class op_kind : std::uint8_t
+    {
+        add,
+        cancel,
+        take,
+        depth
+    };
+
+    struct op
+    {
+        op_kind kind = op_kind::add;
+        book_order order; // take: side, price as the limit, amount; prices in cents
+    };
+
+    // xorshift64*, so every run sees the same flow
+    struct rng
+    {
+        std::uint64_t state = 0x9e3779b97f4a7c15ull;
+
+        std::uint32_t next(std::uint32_t bound)
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<std::uint32_t>(((state * 0x2545f4914f6cdd1dull) >> 32) % bound);
+        }
+    };
+
+    std::vector<op> make_flow(std::size_t n)
+    {
+        std::vector<op> flow(n);
+        rng r;
+        int next_id = 1;
+        int mid = 10000; // ticks of 0.01; drifts so the ladder has to move its base now and then
+        for (auto &o : flow)
+        {
+            std::uint32_t kind = r.next(100);
+            if (kind == 0)
+            {
+                o.kind = op_kind::depth;
+                continue;
+            }
+            if (kind < 48 && next_id > 1)
+            {
+                o.kind = op_kind::cancel;
+                o.order.id = next_id - 1 - static_cast<int>(r.next(static_cast<std::uint32_t>(std::min(next_id - 1, 5000))));
+                continue;
+            }
+            o.order.side = r.next(2) ? order_side::buy : order_side::sell;
+            o.order.amount = qty_lots(1 + r.next(20));
+            int sign = o.order.side == order_side::buy ? -1 : 1;
+            if (kind < 58)
+            {
+                // a taker crossing up to 3 ticks through the touch
+                o.kind = op_kind::take;
+                o.order.price = price_ticks(mid - sign * static_cast<int>(r.next(4)));
+                continue;
+            }
+            o.order.id = next_id++;
+            o.order.user_id = static_cast<int>(r.next(1000));
+            o.order.price = price_ticks(mid + sign * (1 + static_cast<int>(r.next(50))));
+            if (r.next(1000) == 0)
+                mid += static_cast<int>(r.next(21)) - 10;
+        }
+        return flow;
+    }
+
+    struct outcome
+    {
+        double seconds = 0;
+        double traded = 0;
+        double depth_amount = 0;
+        std::size_t resting = 0;
+    };
+
+    template <class Book>
+    outcome run(const std::vector<op> &flow, Book &book)
+    {
+        outcome out;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto &o : flow)
+        {
+            switch (o.kind)
+            {
+            case op_kind::add:
+                book.add(o.order);
+                break;
+            case op_kind::cancel:
+                book.cancel(o.order.id);
+                break;
+            case op_kind::take:
+                book.match(o.order.side, o.order.price, o.order.amount, [&out](const auto &, auto traded)
+                           { out.traded += to_double(traded); });
+                break;
+            case op_kind::depth:
+                for (const auto &l : book.bids(10))
+                    out.depth_amount += to_double(l.amount);
+                for (const auto &l : book.asks(10))
+                    out.depth_amount += to_double(l.amount);
+                break;
+            }
+        }
+        out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        out.resting = book.size();
+        return out;
+    }
+
+    // One order per side walked up and then back down, 997 ticks a step (add the new price,
+    // cancel the old one), over several max_ladder_ticks each way. The ladder has
+    // to keep moving its base under the resting orders; each step checks that the book still shows
+    // exactly the two orders where they were put.
+    bool check_drift()
+    {
+        order_book book;
+        int id = 1;
+        std::int64_t bid = 100000000, ask = bid + 1;
+        book.add({id++, 1, order_side::buy, price_ticks(bid), qty_lots(1)});
+        book.add({id++, 1, order_side::sell, price_ticks(ask), qty_lots(1)});
+        for (int step = 0; step < 4 * order_book::max_ladder_ticks / 997; ++step)
+        {
+            int old_bid = id - 2, old_ask = id - 1;
+            std::int64_t move = step < 2 * order_book::max_ladder_ticks / 997 ? 997 : -997;
+            bid += move;
+            ask += move;
+            if (!book.add({id++, 1, order_side::buy, price_ticks(bid), qty_lots(1)}) ||
+                !book.add({id++, 1, order_side::sell, price_ticks(ask), qty_lots(1)}) || !book.cancel(old_bid) ||
+                !book.cancel(old_ask))
+                return false;
+            auto bids = book.bids(), asks = book.asks();
+            if (book.size() != 2 || bids.size() != 1 || asks.size() != 1 || bids[0].price != price_ticks(bid) ||
+                asks[0].price != price_ticks(ask))
+                return false;
+        }
+        return true;
+    }
+
+    void report(const char *name, const outcome &o, std::size_t n)
+    {
+        std::printf("%-22s %8.3f s  %6.1f ns/op\n", name, o.seconds, o.seconds * 1e9 / static_cast<double>(n));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+    if (!check_drift())
+    {
+        std::printf("MISMATCH: ladder lost its orders while drifting\n");
+        return 1;
+    }
+    auto flow = make_flow(n);
+
+    map_book baseline;
+    outcome m = run(flow, baseline);
+    order_book ladder;
+    outcome l = run(flow, ladder);
+
+    std::printf("%zu operations (add / cancel / take / top-10 depth)\n", n);
+    report("std::map<double> book", m, n);
+    report("tick ladder book", l, n);
+    std::printf("speedup %.2fx\n", m.seconds / l.seconds);
+    std::printf("%zu orders resting at the end\n", l.resting);
+    if (m.traded != l.traded || m.depth_amount != l.depth_amount || m.resting != l.resting)
+    {
+        std::printf("MISMATCH: traded %.0f vs %.0f, depth %.0f vs %.0f, resting %zu vs %zu\n", m.traded, l.traded,
+                    m.depth_amount, l.depth_amount, m.resting, l.resting);
+        return 1;
+    }
+    std::printf("same fills, depth and resting orders from both books\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Compares parse_stooq_csv with the istringstream/getline/atof parser fetch_once used before it.
+// Build with -DEXCHANGE_BUILD_BENCHMARKS=ON and run ./stooq-csv-bench [rows] [iterations].
+#include "stooq_csv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::string make_csv(std::size_t rows)
+    {
+        std::string csv = "Symbol,Date,Time,Open,High,Low,Close,Volume\r\n";
+        char line[160];
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            double open = 50.0 + static_cast<double>(i % 977) * 0.37;
+            std::snprintf(line, sizeof(line), "SYM%zu.US,2024-05-17,22:00:09,%.2f,%.2f,%.2f,%.3f,%zu\r\n",
+                          i, open, open * 1.02, open * 0.98, open * 1.004, 100000 + i * 13);
+            csv += line;
+        }
+        return csv;
+    }
+
+    // The previous fetch_once parse loop, minus building JSON.
+    double legacy_parse(const std::string &body, std::size_t &rows_out)
+    {
+        double checksum = 0;
+        std::istringstream csv(body);
+        std::string line;
+        bool header = true;
+        while (std::getline(csv, line))
+        {
+            if (line.empty())
+                continue;
+            if (line.size() > 0 && (line.back() == '\r' || line.back() == '\n'))
+                line.erase(std::remove_if(line.begin(), line.end(), [](char c)
+                                          { return c == '\r' || c == '\n'; }),
+                           line.end());
+            if (header)
+            {
+                header = false;
+                continue;
+            }
+            std::vector<std::string> cols;
+            std::string col;
+            std::stringstream ls(line);
+            while (std::getline(ls, col, ','))
+                cols.push_back(col);
+            if (cols.size() < 8)
+                continue;
+            std::string symbol = cols[0];
+            double open = std::atof(cols[3].c_str());
+            double high = std::atof(cols[4].c_str());
+            double low = std::atof(cols[5].c_str());
+            double close = std::atof(cols[6].c_str());
+            checksum += open + high + low + close + static_cast<double>(symbol.size());
+            rows_out++;
+        }
+        return checksum;
+    }
+
+    double fast_parse(const std::string &body, std::size_t &rows_out)
+    {
+        double checksum = 0;
+        rows_out += parse_stooq_csv(body, [&](const stooq_row &r)
+                                    { checksum += r.open + r.high + r.low + r.close + static_cast<double>(r.symbol.size()); });
+        return checksum;
+    }
+
+    template <class F>
+    double run(const char *name, const std::string &body, std::size_t iterations, F &&parse)
+    {
+        std::size_t rows = 0;
+        double checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            checksum += parse(body, rows);
+        auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-8s %10.1f ns/row %8.2f ms/body  (checksum %.3f)\n", name, ns / static_cast<double>(rows),
+                    ns / 1e6 / static_cast<double>(iterations), checksum);
+        return ns;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    std::size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    std::string body = make_csv(rows);
+    std::printf("%zu rows, %zu bytes, %zu iterations\n", rows, body.size(), iterations);
+    double legacy = run("legacy", body, iterations, legacy_parse);
+    double fast = run("fast", body, iterations, fast_parse);
+    std::printf("speedup  %.1fx\n", legacy / fast);
+    return 0;
+}
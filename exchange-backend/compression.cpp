@@ -0,0 +1,113 @@
+#include "compression.hpp"
+#include <brotli/encode.h>
+#include <zlib.h>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+std::string gzip_compress(std::string_view data)
+{
+    z_stream zs{};
+    // 15 window bits + 16 selects the gzip wrapper instead of raw zlib
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("gzip: deflateInit2 failed");
+    std::string out;
+    out.resize(deflateBound(&zs, static_cast<uLong>(data.size())));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END)
+        throw std::runtime_error("gzip: deflate failed rc=" + std::to_string(rc));
+    out.resize(zs.total_out);
+    return out;
+}
+
+std::string brotli_compress(std::string_view data)
+{
+    std::string out;
+    out.resize(BrotliEncoderMaxCompressedSize(data.size()));
+    size_t out_size = out.size();
+    // quality 9 keeps a multi-hundred-KB payload well under a second on the refresh thread
+    if (!BrotliEncoderCompress(9, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, data.size(),
+                               reinterpret_cast<const uint8_t *>(data.data()), &out_size,
+                               reinterpret_cast<uint8_t *>(out.data())))
+        throw std::runtime_error("brotli: encode failed");
+    out.resize(out_size);
+    return out;
+}
+
+namespace
+{
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    bool iequals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (::tolower(static_cast<unsigned char>(a[i])) != ::tolower(static_cast<unsigned char>(b[i])))
+                return false;
+        }
+        return true;
+    }
+}
+
+content_coding negotiate_coding(std::string_view accept_encoding, bool have_br, bool have_gzip)
+{
+    double q_br = -1, q_gzip = -1, q_identity = -1, q_any = -1;
+    while (!accept_encoding.empty())
+    {
+        auto comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view{} : accept_encoding.substr(comma + 1);
+
+        double q = 1.0;
+        auto semi = item.find(';');
+        std::string_view coding = trim(item.substr(0, semi));
+        if (semi != std::string_view::npos)
+        {
+            std::string_view param = trim(item.substr(semi + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+                q = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+        }
+        if (iequals(coding, "br"))
+            q_br = q;
+        else if (iequals(coding, "gzip") || iequals(coding, "x-gzip"))
+            q_gzip = q;
+        else if (iequals(coding, "identity"))
+            q_identity = q;
+        else if (coding == "*")
+            q_any = q;
+    }
+    // codings not listed fall back to the wildcard; identity is acceptable unless explicitly refused
+    if (q_br < 0)
+        q_br = q_any < 0 ? 0 : q_any;
+    if (q_gzip < 0)
+        q_gzip = q_any < 0 ? 0 : q_any;
+    if (q_identity < 0)
+        q_identity = q_any == 0 ? 0 : 1;
+    // a coding the caller can't produce is as good as refused
+    if (!have_br)
+        q_br = 0;
+    if (!have_gzip)
+        q_gzip = 0;
+
+    if (q_br > 0 && q_br >= q_gzip && q_br >= q_identity)
+        return content_coding::br;
+    if (q_gzip > 0 && q_gzip >= q_identity)
+        return content_coding::gzip;
+    if (q_identity > 0)
+        return content_coding::identity;
+    return content_coding::none;
+}
@@ -0,0 +1,102 @@
+#include "fixed_point.hpp"
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+    constexpr std::int64_t pow10[max_decimals + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+    // Above this many units the value stops fitting comfortably in an int64 or a double's mantissa.
+    constexpr std::int64_t max_units = std::int64_t{1} << 53;
+}
+
+std::optional<std::int64_t> parse_decimal(std::string_view text, int decimals)
+{
+    if (decimals < 0 || decimals > max_decimals)
+        return std::nullopt;
+    bool negative = !text.empty() && text.front() == '-';
+    if (negative)
+        text.remove_prefix(1);
+    std::size_t dot = text.find('.');
+    std::string_view whole = text.substr(0, dot);
+    std::string_view fraction = dot == std::string_view::npos ? std::string_view{} : text.substr(dot + 1);
+    if (whole.empty() && fraction.empty())
+        return std::nullopt;
+    // bounding the whole part before it is scaled keeps every step below within int64
+    std::int64_t max_whole = max_units / pow10[decimals];
+    std::int64_t units = 0;
+    for (char c : whole)
+    {
+        if (c < '0' || c > '9')
+            return std::nullopt;
+        units = units * 10 + (c - '0');
+        if (units > max_whole)
+            return std::nullopt;
+    }
+    for (std::size_t i = 0; i < fraction.size(); ++i)
+    {
+        char c = fraction[i];
+        if (c < '0' || c > '9')
+            return std::nullopt;
+        if (static_cast<int>(i) >= decimals)
+        {
+            if (c != '0')
+                return std::nullopt; // finer than one unit
+            continue;
+        }
+        units = units * 10 + (c - '0');
+    }
+    for (int i = static_cast<int>(fraction.size()); i < decimals; ++i)
+        units *= 10;
+    if (units > max_units)
+        return std::nullopt;
+    return negative ? -units : units;
+}
+
+std::optional<std::int64_t> decimal_from_double(double v, int decimals)
+{
+    if (decimals < 0 || decimals > max_decimals)
+        return std::nullopt;
+    double scaled = v * static_cast<double>(pow10[decimals]);
+    if (!std::isfinite(scaled) || std::fabs(scaled) > static_cast<double>(max_units))
+        return std::nullopt;
+    double rounded = std::round(scaled);
+    // 101.53 * 100 is 10152.999999999998; anything further off than that kind of noise is a
+    // genuinely finer value
+    if (std::fabs(scaled - rounded) > 1e-6)
+        return std::nullopt;
+    return static_cast<std::int64_t>(rounded);
+}
+
+char *format_decimal(char *buf, std::int64_t units, int decimals)
+{
+    if (units < 0)
+    {
+        *buf++ = '-';
+        units = -units;
+    }
+    std::int64_t scale = pow10[decimals];
+    buf = std::to_chars(buf, buf + 20, units / scale).ptr;
+    std::int64_t fraction = units % scale;
+    if (fraction == 0)
+        return buf;
+    *buf++ = '.';
+    for (std::int64_t digit = scale / 10; fraction != 0; digit /= 10)
+    {
+        *buf++ = static_cast<char>('0' + fraction / digit);
+        fraction %= digit;
+    }
+    return buf;
+}
+
+std::string format_decimal(std::int64_t units, int decimals)
+{
+    char buf[32];
+    return std::string(buf, format_decimal(buf, units, decimals));
+}
+
+double decimal_to_double(std::int64_t units, int decimals)
+{
+    // one correctly rounded division, so 10153 at 2 decimals is exactly the double nearest 101.53
+    return static_cast<double>(units) / static_cast<double>(pow10[decimals]);
+}
@@ -1,35 +1,187 @@
 #include "json.hpp"
 #include "http_server.hpp"
+#include "compression.hpp"
+#include "upstream_client.hpp"
+#include "stooq_csv.hpp"
+#include "yahoo_quotes.hpp"
+#include "quote_table.hpp"
+#include "json_writer.hpp"
+#include "pg_pool.hpp"
+#include "matching_engine.hpp"
+#include "mpsc_queue.hpp"
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/ssl.hpp>
-#include <boost/beast/ssl.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
 #include <pqxx/pqxx>
 #include <iostream>
 #include <chrono>
 #include <thread>
-#include <mutex>
 #include <atomic>
 #include <cstdlib>
+#include <cstdio>
+#include <climits>
 #include <algorithm>
 #include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string_view>
+#include <charconv>
+#include <optional>
+#include <future>
+#include <array>
+#include <utility>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <random>
 
 using tcp = boost::asio::ip::tcp;
+namespace net = boost::asio;
+namespace beast = boost::beast;
 namespace http = boost::beast::http;
+namespace websocket = boost::beast::websocket;
 
 namespace
 {
-    std::mutex stocks_mtx;
-    nlohmann::json stocks_cache = nlohmann::json::array();
-    std::chrono::steady_clock::time_point stocks_last;
-    std::atomic<bool> stocks_ready{false};
+    // Change set from an earlier version to the snapshot holding it, pre-rendered for every channel.
+    struct stocks_delta
+    {
+        std::uint64_t from = 0;
+        std::string message;   // {"type":"delta",...}, served by /stocks?since= and /ws/stocks
+        std::string sse_event; // same message framed for /stocks/stream
+    };
+
+    // How many past versions a snapshot keeps deltas for; older clients get a full snapshot.
+    constexpr std::size_t delta_history = 16;
+
+    // Immutable result of one refresh, serialized once and shared by every request that serves it.
+    struct stocks_snapshot
+    {
+        std::uint64_t version = 0; // bumped on every publish; with stocks_epoch(), the ETag
+        std::string body;
+        std::shared_ptr<const quote_table> quotes; // the data itself; everything below is serialized from it
+        std::vector<std::string> rows;             // each quote serialized on its own, one per table row
+        std::string gzip_body; // empty when compression doesn't pay off
+        std::string br_body;
+        std::string ws_message; // body wrapped in the /ws/stocks push envelope
+        std::string sse_event;  // body framed as a /stocks/stream event
+        std::vector<stocks_delta> deltas; // newest first, including an empty one from `version` itself
+        std::chrono::steady_clock::time_point fetched_at;
+
+        const stocks_delta *delta_from(std::uint64_t from) const
+        {
+            for (const auto &d : deltas)
+            {
+                if (d.from == from)
+                    return &d;
+            }
+            return nullptr;
+        }
+    };
+    // Swapped with std::atomic_store/atomic_load; null until the first refresh lands.
+    std::shared_ptr<const stocks_snapshot> stocks_current;
+
+    // Random id of this process. Snapshot versions restart at 1 on every start, so anything a client
+    // hands back to name a version is scoped to the epoch it was issued under.
+    const std::string &stocks_epoch()
+    {
+        static const std::string epoch = []
+        {
+            std::random_device rd;
+            std::uint64_t id = (static_cast<std::uint64_t>(rd()) << 32) ^ rd() ^
+                               static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+            char buf[16];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), id, 16);
+            return std::string(buf, end);
+        }();
+        return epoch;
+    }
+
+    // "<epoch>-<version>": a snapshot version as it is handed to clients, e.g. as an SSE event id.
+    std::string version_tag(std::uint64_t version)
+    {
+        return stocks_epoch() + "-" + std::to_string(version);
+    }
+
+    // Reads a version_tag(). False when `tag` isn't one; `version` is 0 for a tag from another
+    // epoch, which names no version of this process.
+    bool parse_version_tag(std::string_view tag, std::uint64_t &version)
+    {
+        auto dash = tag.find('-');
+        if (dash == 0 || dash == std::string_view::npos)
+            return false;
+        std::string_view epoch = tag.substr(0, dash), number = tag.substr(dash + 1);
+        auto [end, ec] = std::from_chars(number.data(), number.data() + number.size(), version);
+        if (ec != std::errc{} || end != number.data() + number.size())
+            return false;
+        if (epoch != stocks_epoch())
+            version = 0;
+        return true;
+    }
+
+    // A long-lived connection (/ws/stocks, /stocks/stream) that receives every published snapshot.
+    class stream_subscriber
+    {
+    public:
+        virtual ~stream_subscriber() = default;
+        // Called from the publishing thread; implementations hop onto their own strand.
+        virtual void push(const std::shared_ptr<const stocks_snapshot> &snap) = 0;
+    };
+
+    // Frames a subscriber may have waiting before it is treated as a slow reader and dropped.
+    constexpr std::size_t max_pending_frames = 4;
+
+    std::mutex subscribers_mtx;
+    std::unordered_map<stream_subscriber *, std::weak_ptr<stream_subscriber>> subscribers;
+
+    // Registers `sub` and returns the snapshot it should start from. Shares the lock with
+    // broadcast_stocks so a new subscriber can't be missed by a publish that races with it.
+    std::shared_ptr<const stocks_snapshot> subscribe(const std::shared_ptr<stream_subscriber> &sub)
+    {
+        std::lock_guard<std::mutex> lk(subscribers_mtx);
+        subscribers[sub.get()] = sub;
+        return std::atomic_load(&stocks_current);
+    }
+
+    void unsubscribe(stream_subscriber *sub)
+    {
+        std::lock_guard<std::mutex> lk(subscribers_mtx);
+        subscribers.erase(sub);
+    }
+
+    void broadcast_stocks(const std::shared_ptr<const stocks_snapshot> &snap)
+    {
+        // take strong refs under the lock, push outside it
+        std::vector<std::shared_ptr<stream_subscriber>> targets;
+        {
+            std::lock_guard<std::mutex> lk(subscribers_mtx);
+            targets.reserve(subscribers.size());
+            for (const auto &kv : subscribers)
+            {
+                if (auto sp = kv.second.lock())
+                    targets.push_back(std::move(sp));
+            }
+        }
+        for (const auto &sub : targets)
+            sub->push(snap);
+    }
     std::atomic<bool> stocks_stop{false};
     int refresh_seconds = 60; // default
     std::string symbols_cfg = "AAPL,MSFT,TSLA,AMZN,GOOG";
     std::string stocks_provider = "STOOQ";             // options: STOOQ, YAHOO, TRADING212
     std::string scraper_url = "http://localhost:9000"; // for TRADING212 provider
+    int stooq_fallback_concurrency = 8;      // per-symbol requests in flight at once
+    int stooq_fallback_deadline_seconds = 20; // budget for the whole per-symbol fallback stage
+    int stooq_max_target_length = 2000;       // longest request target a single Stooq batch may use
+    std::string pg_conninfo = "dbname=exchange user=leonmamic";
+    int pg_pool_size = 4; // Postgres connections kept open, and threads in blocking_pool()
+    instrument book_instrument; // decimals of the order book's prices and amounts
 
     std::string to_upper(std::string s)
     {
@@ -44,156 +196,119 @@ namespace
         return s;
     }
 
-    nlohmann::json fetch_once(bool allow_insecure_retry = true)
+    // Shared by every provider so keep-alive connections, DNS answers and TLS sessions survive
+    // from one refresh to the next.
+    upstream_client &upstream()
     {
-        nlohmann::json result = nlohmann::json::array();
-        std::string provider = to_upper(stocks_provider);
-        if (provider == "STOOQ")
+        static upstream_client client{1};
+        return client;
+    }
+
+    // Splits symbols into as few Stooq quote targets as possible, each at most `max_target_length`
+    // bytes long (a lone symbol over the limit still gets its own target). Order is preserved.
+    std::vector<std::string> plan_stooq_batches(const std::vector<std::string> &symbols, std::size_t max_target_length)
+    {
+        static const std::string prefix = "/q/l/?s=";
+        static const std::string suffix = "&f=sd2t2ohlcv&h&e=csv"; // include open/high/low/close
+        std::vector<std::string> targets;
+        std::string current;
+        for (const auto &sym : symbols)
         {
-            // Build CSV request to stooq.com for symbols (append .US for US stocks)
-            std::string symbols_query;
+            std::string item = sym + ".US";
+            if (!current.empty() && prefix.size() + current.size() + 1 + item.size() + suffix.size() > max_target_length)
             {
-                std::stringstream ss(symbols_cfg);
-                std::string item;
-                bool first = true;
-                while (std::getline(ss, item, ','))
-                {
-                    std::string trimmed;
-                    for (char c : item)
-                    {
-                        if (!isspace(static_cast<unsigned char>(c)))
-                            trimmed.push_back(c);
-                    }
-                    if (trimmed.empty())
-                        continue;
-                    if (!first)
-                        symbols_query += ",";
-                    first = false;
-                    std::string upper = to_upper(trimmed);
-                    symbols_query += upper + ".US"; // stooq symbol format requires uppercase
-                }
+                targets.push_back(prefix + current + suffix);
+                current.clear();
             }
-            std::string host = "stooq.com";
-            std::string target = "/q/l/?s=" + symbols_query + "&f=sd2t2ohlcv&h&e=csv"; // include open/high/low/close
-            auto fetch_stooq_http = [&](std::string scheme, std::string host_in, std::string tgt)
+            if (!current.empty())
+                current += ',';
+            current += item;
+        }
+        if (!current.empty())
+            targets.push_back(prefix + current + suffix);
+        return targets;
+    }
+
+    // Where Stooq requests go. stooq.com answers plain http with a redirect to https; once seen,
+    // later requests (and refreshes) go straight to the redirect target.
+    upstream_endpoint stooq_endpoint{"http", "stooq.com", ""};
+
+    // GETs every target from Stooq with at most stooq_fallback_concurrency requests in flight, following
+    // redirects. `on_response(index, res)` runs on the calling thread for each final response; targets
+    // still outstanding at `deadline` are abandoned.
+    template <class OnResponse>
+    void stooq_fetch_all(const std::vector<std::string> &targets, std::chrono::steady_clock::time_point deadline, OnResponse &&on_response)
+    {
+        struct request
+        {
+            std::size_t index;
+            std::string target;
+            int redirects;
+        };
+        std::deque<request> queued;
+        for (std::size_t i = 0; i < targets.size(); ++i)
+            queued.push_back({i, targets[i], 0});
+        std::deque<std::pair<request, std::future<http::response<http::string_body>>>> in_flight;
+        while (!queued.empty() || !in_flight.empty())
+        {
+            while (!queued.empty() && in_flight.size() < static_cast<std::size_t>(stooq_fallback_concurrency))
             {
-                boost::asio::io_context ioc_api;
-                if (scheme == "http")
-                {
-                    tcp::resolver resolver{ioc_api};
-                    auto endpoints = resolver.resolve(host_in, "80");
-                    tcp::socket sock{ioc_api};
-                    boost::asio::connect(sock, endpoints.begin(), endpoints.end());
-                    http::request<http::string_body> req_api{http::verb::get, tgt, 11};
-                    req_api.set(http::field::host, host_in);
-                    req_api.set(http::field::user_agent, "Mozilla/5.0");
-                    req_api.set(http::field::accept, "text/csv");
-                    http::write(sock, req_api);
-                    boost::beast::flat_buffer buffer_api;
-                    http::response<http::string_body> res_api;
-                    http::read(sock, buffer_api, res_api);
-                    return res_api;
-                }
-                else
-                { // https
-                    boost::asio::ssl::context tls_ctx{boost::asio::ssl::context::tls_client};
-                    tls_ctx.set_default_verify_paths();
-                    tls_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
-                    tcp::resolver resolver{ioc_api};
-                    auto endpoints = resolver.resolve(host_in, "443");
-                    boost::beast::ssl_stream<tcp::socket> stream{ioc_api, tls_ctx};
-                    if (!SSL_set_tlsext_host_name(stream.native_handle(), host_in.c_str()))
-                        throw std::runtime_error("SNI failure");
-                    boost::asio::connect(stream.next_layer(), endpoints.begin(), endpoints.end());
-                    stream.handshake(boost::asio::ssl::stream_base::client);
-                    http::request<http::string_body> req_api{http::verb::get, tgt, 11};
-                    req_api.set(http::field::host, host_in);
-                    req_api.set(http::field::user_agent, "Mozilla/5.0");
-                    req_api.set(http::field::accept, "text/csv");
-                    http::write(stream, req_api);
-                    boost::beast::flat_buffer buffer_api;
-                    http::response<http::string_body> res_api;
-                    http::read(stream, buffer_api, res_api);
-                    return res_api;
-                }
-            };
-            std::cerr << "[stooq] fetching symbols=" << symbols_query << std::endl;
-            http::response<http::string_body> res_api = fetch_stooq_http("http", host, target);
-            std::cerr << "[stooq] initial status=" << static_cast<int>(res_api.result()) << std::endl;
-            if (res_api.result() == http::status::moved_permanently || res_api.result() == http::status::found)
+                http::fields headers;
+                headers.set(http::field::user_agent, "Mozilla/5.0");
+                headers.set(http::field::accept, "text/csv");
+                auto fut = upstream().async_get(stooq_endpoint, queued.front().target, headers);
+                in_flight.emplace_back(std::move(queued.front()), std::move(fut));
+                queued.pop_front();
+            }
+            auto &[req, fut] = in_flight.front();
+            if (fut.wait_until(deadline) != std::future_status::ready)
+            {
+                std::cerr << "[stooq] deadline hit, giving up on " << (queued.size() + in_flight.size()) << " request(s)" << std::endl;
+                return;
+            }
+            try
             {
-                auto loc_it = res_api.find(http::field::location);
-                if (loc_it != res_api.end())
+                auto res = fut.get();
+                if ((res.result() == http::status::moved_permanently || res.result() == http::status::found) && req.redirects < 3)
                 {
-                    std::string loc = std::string(loc_it->value());
+                    auto loc_it = res.find(http::field::location);
+                    std::string loc = loc_it != res.end() ? std::string(loc_it->value()) : std::string();
+                    std::string new_target = req.target;
                     // location could be full URL
-                    if (loc.rfind("https://", 0) == 0)
+                    if (loc.rfind("https://", 0) == 0 || loc.rfind("http://", 0) == 0)
                     {
-                        std::string without = loc.substr(8); // after https://
+                        bool tls = loc.rfind("https://", 0) == 0;
+                        std::string without = loc.substr(tls ? 8 : 7);
                         auto slash = without.find('/');
-                        std::string new_host = without.substr(0, slash);
-                        std::string new_target = slash == std::string::npos ? "/" : without.substr(slash);
-                        std::cerr << "[stooq] following redirect to host=" << new_host << " target=" << new_target << std::endl;
-                        res_api = fetch_stooq_http("https", new_host, new_target);
+                        stooq_endpoint = {tls ? "https" : "http", without.substr(0, slash), ""};
+                        new_target = slash == std::string::npos ? "/" : without.substr(slash);
                     }
+                    else if (loc.rfind("/", 0) == 0)
+                        new_target = loc;
+                    else
+                        stooq_endpoint.scheme = "https"; // no usable location header, try https same target
+                    std::cerr << "[stooq] following redirect to host=" << stooq_endpoint.host << " target=" << new_target << std::endl;
+                    queued.push_front({req.index, new_target, req.redirects + 1});
                 }
                 else
                 {
-                    // fallback attempt https same target
-                    std::cerr << "[stooq] no location header, trying https same target" << std::endl;
-                    res_api = fetch_stooq_http("https", host, target);
-                }
-            }
-            std::cerr << "[stooq] final status=" << static_cast<int>(res_api.result()) << " length=" << res_api.body().size() << std::endl;
-            if (res_api.result() != http::status::ok)
-            {
-                throw std::runtime_error("stooq_upstream=" + std::to_string(static_cast<int>(res_api.result())));
-            }
-            // Parse CSV
-            std::istringstream csv(res_api.body());
-            std::string line;
-            bool header = true;
-            int parsed_rows = 0;
-            while (std::getline(csv, line))
-            {
-                if (line.empty())
-                    continue;
-                if (line.size() > 0 && (line.back() == '\r' || line.back() == '\n'))
-                    line.erase(std::remove_if(line.begin(), line.end(), [](char c)
-                                              { return c == '\r' || c == '\n'; }),
-                               line.end());
-                if (header)
-                {
-                    header = false;
-                    continue;
+                    on_response(req.index, res);
                 }
-                std::vector<std::string> cols;
-                std::string col;
-                std::stringstream ls(line);
-                while (std::getline(ls, col, ','))
-                    cols.push_back(col);
-                if (cols.size() < 8)
-                    continue; // Symbol,Date,Time,Open,High,Low,Close,Volume
-                std::string symbol = cols[0];
-                double open = std::atof(cols[3].c_str());
-                double high = std::atof(cols[4].c_str());
-                double low = std::atof(cols[5].c_str());
-                double close = std::atof(cols[6].c_str());
-                double change = close - open;
-                double percent = open != 0.0 ? (change / open) * 100.0 : 0.0;
-                result.push_back({{"symbol", symbol.substr(0, symbol.find('.'))},
-                                  {"name", symbol},
-                                  {"price", close},
-                                  {"change", change},
-                                  {"percent", percent}});
-                parsed_rows++;
             }
-            std::cerr << "[stooq] parsed_rows=" << parsed_rows << std::endl;
-            if (parsed_rows == 0)
+            catch (const std::exception &e)
             {
-                std::cerr << "[stooq] CSV body was: " << res_api.body() << std::endl;
+                std::cerr << "[stooq] request failed target=" << req.target << " err=" << e.what() << std::endl;
             }
-            // If not all requested symbols returned, perform per-symbol fallback
+            in_flight.pop_front();
+        }
+    }
+
+    std::vector<quote> fetch_once(bool allow_insecure_retry = true)
+    {
+        std::vector<quote> result;
+        std::string provider = to_upper(stocks_provider);
+        if (provider == "STOOQ")
+        {
             std::vector<std::string> requested_symbols;
             {
                 std::stringstream ss(symbols_cfg);
@@ -207,79 +322,88 @@ namespace
                             trimmed.push_back(c);
                     }
                     if (!trimmed.empty())
-                        requested_symbols.push_back(to_upper(trimmed));
+                        requested_symbols.push_back(to_upper(trimmed)); // stooq symbol format requires uppercase
                 }
             }
-            std::unordered_map<std::string, nlohmann::json> map_current;
-            for (auto &o : result)
+            std::unordered_map<std::string, quote> map_current;
+            // Parse CSV
+            auto parse_csv = [&](const std::string &body)
+            {
+                return static_cast<int>(parse_stooq_csv(body, [&](const stooq_row &row)
+                                                        {
+                    double change = row.close - row.open;
+                    double percent = row.open != 0.0 ? (change / row.open) * 100.0 : 0.0;
+                    std::string sym(row.symbol.substr(0, row.symbol.find('.')));
+                    quote &q = map_current[sym];
+                    q.symbol = sym;
+                    q.name = std::string(row.symbol);
+                    q.price = row.close;
+                    q.change = change;
+                    q.percent = percent;
+                    q.open = row.open;
+                    q.high = row.high;
+                    q.low = row.low;
+                    q.volume = row.volume; }));
+            };
+
+            auto batches = plan_stooq_batches(requested_symbols, static_cast<std::size_t>(stooq_max_target_length));
+            std::cerr << "[stooq] fetching " << requested_symbols.size() << " symbols in " << batches.size() << " batch(es)" << std::endl;
+            int parsed_rows = 0;
+            int batches_ok = 0;
+            int last_status = 0;
+            // every request already has its own io timeout; this only caps a pathological run of them
+            stooq_fetch_all(batches, std::chrono::steady_clock::now() + std::chrono::minutes(5), [&](std::size_t i, http::response<http::string_body> &res_api)
+                            {
+                last_status = static_cast<int>(res_api.result());
+                std::cerr << "[stooq] batch " << i << " status=" << last_status << " length=" << res_api.body().size() << std::endl;
+                if (res_api.result() != http::status::ok)
+                    return;
+                batches_ok++;
+                int rows = parse_csv(res_api.body());
+                if (rows == 0)
+                    std::cerr << "[stooq] CSV body was: " << res_api.body() << std::endl;
+                parsed_rows += rows; });
+            std::cerr << "[stooq] parsed_rows=" << parsed_rows << std::endl;
+            if (batches_ok == 0)
             {
-                map_current[o["symbol"].get<std::string>()] = o;
+                throw std::runtime_error("stooq_upstream=" + std::to_string(last_status));
             }
+            // If not all requested symbols returned, perform per-symbol fallback
             if (map_current.size() < requested_symbols.size())
             {
+                std::vector<std::string> single_targets;
                 for (const auto &sym : requested_symbols)
                 {
                     if (map_current.find(sym) != map_current.end())
                         continue;
-                    try
-                    {
-                        std::string single = to_upper(sym) + ".US";
-                        std::string single_target = "/q/l/?s=" + single + "&f=sd2t2ohlcv&h&e=csv";
-                        auto single_res = fetch_stooq_http("https", host, single_target);
-                        if (single_res.result() == http::status::ok)
-                        {
-                            std::istringstream scsv(single_res.body());
-                            std::string l;
-                            bool hdr = true;
-                            while (std::getline(scsv, l))
-                            {
-                                if (hdr)
-                                {
-                                    hdr = false;
-                                    continue;
-                                }
-                                if (l.empty())
-                                    continue;
-                                std::vector<std::string> cols;
-                                std::stringstream ls(l);
-                                std::string col;
-                                while (std::getline(ls, col, ','))
-                                    cols.push_back(col);
-                                if (cols.size() < 8)
-                                    continue;
-                                double open = std::atof(cols[3].c_str());
-                                double close = std::atof(cols[6].c_str());
-                                double change = close - open;
-                                double percent = open != 0 ? (change / open) * 100.0 : 0.0;
-                                map_current[sym] = nlohmann::json{{"symbol", sym}, {"name", cols[0]}, {"price", close}, {"change", change}, {"percent", percent}};
-                            }
-                        }
-                    }
-                    catch (const std::exception &se)
-                    {
-                        std::cerr << "[stooq] per-symbol fetch failed sym=" << sym << " err=" << se.what() << std::endl;
-                    }
+                    single_targets.push_back("/q/l/?s=" + sym + ".US&f=sd2t2ohlcv&h&e=csv");
                 }
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(stooq_fallback_deadline_seconds);
+                stooq_fetch_all(single_targets, deadline, [&](std::size_t, http::response<http::string_body> &single_res)
+                                {
+                    if (single_res.result() == http::status::ok)
+                        parse_csv(single_res.body()); });
             }
             // Reconstruct ordered result, filtering symbols with price==0 if we have at least one non-zero price overall
             bool any_non_zero = false;
             for (auto &kv : map_current)
             {
-                if (kv.second["price"].get<double>() != 0.0)
+                if (kv.second.price != 0.0)
                 {
                     any_non_zero = true;
                     break;
                 }
             }
-            nlohmann::json ordered = nlohmann::json::array();
+            std::vector<quote> ordered;
+            ordered.reserve(requested_symbols.size());
             for (const auto &sym : requested_symbols)
             {
                 auto it = map_current.find(sym);
                 if (it == map_current.end())
                     continue;
-                if (any_non_zero && it->second["price"].get<double>() == 0.0)
+                if (any_non_zero && it->second.price == 0.0)
                     continue; // drop zero-only if we have real data
-                ordered.push_back(it->second);
+                ordered.push_back(std::move(it->second));
             }
             if (ordered.empty())
             {
@@ -312,18 +436,9 @@ namespace
                 }
             }
 
-            boost::asio::io_context ioc_api;
-            tcp::resolver resolver{ioc_api};
-            auto endpoints = resolver.resolve(scraper_host, scraper_port);
-            tcp::socket sock{ioc_api};
-            boost::asio::connect(sock, endpoints.begin(), endpoints.end());
-            http::request<http::string_body> req_api{http::verb::get, scraper_path, 11};
-            req_api.set(http::field::host, scraper_host + ":" + scraper_port);
-            req_api.set(http::field::user_agent, "exchange-backend/1.0");
-            http::write(sock, req_api);
-            boost::beast::flat_buffer buffer_api;
-            http::response<http::string_body> res_api;
-            http::read(sock, buffer_api, res_api);
+            http::fields headers;
+            headers.set(http::field::user_agent, "exchange-backend/1.0");
+            auto res_api = upstream().get({"http", scraper_host, scraper_port}, scraper_path, headers);
 
             if (res_api.result() != http::status::ok)
             {
@@ -332,7 +447,18 @@ namespace
 
             auto scraper_json = nlohmann::json::parse(res_api.body());
             std::cerr << "[trading212] received " << scraper_json.size() << " symbols from scraper" << std::endl;
-            return scraper_json;
+            result.reserve(scraper_json.size());
+            for (const auto &q : scraper_json)
+            {
+                quote row;
+                row.symbol = q.value("symbol", "");
+                row.name = q.value("name", "");
+                row.price = q.value("price", 0.0);
+                row.change = q.value("change", 0.0);
+                row.percent = q.value("percent", 0.0);
+                result.push_back(std::move(row));
+            }
+            return result;
         }
         // Default / YAHOO provider (original logic)
         std::string host = "query1.finance.yahoo.com";
@@ -340,49 +466,26 @@ namespace
         std::string target = "/v7/finance/quote?symbols=" + symbols_cfg;
         auto perform = [&](bool insecure)
         {
-            boost::asio::io_context ioc_api;
-            boost::asio::ssl::context tls_ctx{boost::asio::ssl::context::tls_client};
-            if (!insecure)
-            {
-                tls_ctx.set_default_verify_paths();
-                tls_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
-            }
-            else
-            {
-                tls_ctx.set_verify_mode(boost::asio::ssl::verify_none);
-            }
-            tcp::resolver resolver{ioc_api};
-            auto endpoints = resolver.resolve(host, "443");
-            boost::beast::ssl_stream<tcp::socket> stream{ioc_api, tls_ctx};
-            if (!SSL_set_tlsext_host_name(stream.native_handle(), host.c_str()))
-                throw std::runtime_error("SNI failure");
-            boost::asio::connect(stream.next_layer(), endpoints.begin(), endpoints.end());
-            stream.handshake(boost::asio::ssl::stream_base::client);
-            http::request<http::string_body> req_api{http::verb::get, target, 11};
-            req_api.set(http::field::host, host);
-            req_api.set(http::field::user_agent, "Mozilla/5.0 (Macintosh) AppleWebKit/537.36 Chrome Safari");
-            req_api.set(http::field::accept, "application/json,text/plain,*/*");
-            req_api.set(http::field::accept_language, "en-US,en;q=0.9");
-            req_api.set(http::field::accept_encoding, "identity");
-            req_api.set(http::field::connection, "close");
-            http::write(stream, req_api);
-            boost::beast::flat_buffer buffer_api;
-            http::response<http::string_body> res_api;
-            http::read(stream, buffer_api, res_api);
+            http::fields headers;
+            headers.set(http::field::user_agent, "Mozilla/5.0 (Macintosh) AppleWebKit/537.36 Chrome Safari");
+            headers.set(http::field::accept, "application/json,text/plain,*/*");
+            headers.set(http::field::accept_language, "en-US,en;q=0.9");
+            headers.set(http::field::accept_encoding, "identity");
+            auto res_api = upstream().get({"https", host, "", !insecure}, target, headers);
             if (res_api.result() != http::status::ok)
             {
                 std::string body_snip = res_api.body().substr(0, 200);
                 throw std::runtime_error("upstream=" + std::to_string(static_cast<int>(res_api.result())) + " host=" + host + " body_snip=" + body_snip);
             }
-            auto api_json = nlohmann::json::parse(res_api.body());
-            auto quotes = api_json["quoteResponse"]["result"];
-            for (const auto &stock : quotes)
+            for (auto &stock : parse_yahoo_quotes(res_api.body()))
             {
-                result.push_back({{"symbol", stock.value("symbol", "")},
-                                  {"name", stock.value("shortName", "")},
-                                  {"price", stock.value("regularMarketPrice", 0.0)},
-                                  {"change", stock.value("regularMarketChange", 0.0)},
-                                  {"percent", stock.value("regularMarketChangePercent", 0.0)}});
+                quote row;
+                row.symbol = std::move(stock.symbol);
+                row.name = std::move(stock.short_name);
+                row.price = stock.price;
+                row.change = stock.change;
+                row.percent = stock.percent;
+                result.push_back(std::move(row));
             }
         };
         try
@@ -424,6 +527,107 @@ namespace
         return result;
     }
 
+    nlohmann::json quote_json(const quote_table &t, std::size_t row)
+    {
+        return {{"symbol", t.symbol(row)},
+                {"name", t.name[row]},
+                {"price", t.price[row]},
+                {"change", t.change[row]},
+                {"percent", t.percent[row]}};
+    }
+
+    // Symbols that are new or whose price/change/percent moved since `old`, plus symbols that vanished.
+    // Both tables share interned ids, so rows are matched without hashing any strings.
+    stocks_delta make_delta(std::uint64_t from, std::uint64_t version, const quote_table &old, const quote_table &current)
+    {
+        nlohmann::json changes = nlohmann::json::array();
+        for (std::size_t row = 0; row < current.size(); ++row)
+        {
+            std::int32_t was = old.row(current.symbol_id[row]);
+            if (was < 0)
+            {
+                changes.push_back(quote_json(current, row)); // new symbol, send the whole row
+                continue;
+            }
+            if (old.price[was] != current.price[row] || old.change[was] != current.change[row] || old.percent[was] != current.percent[row])
+            {
+                changes.push_back({{"symbol", current.symbol(row)},
+                                   {"price", current.price[row]},
+                                   {"change", current.change[row]},
+                                   {"percent", current.percent[row]}});
+            }
+        }
+        nlohmann::json removed = nlohmann::json::array();
+        for (std::size_t row = 0; row < old.size(); ++row)
+        {
+            if (current.row(old.symbol_id[row]) < 0)
+                removed.push_back(old.symbol(row));
+        }
+        stocks_delta d;
+        d.from = from;
+        d.message = nlohmann::json{{"type", "delta"}, {"from", from}, {"version", version}, {"id", version_tag(version)}, {"changes", changes}, {"removed", removed}}.dump();
+        d.sse_event = "id: " + version_tag(version) + "\nevent: delta\ndata: " + d.message + "\n\n";
+        return d;
+    }
+
+    void publish_stocks(const std::vector<quote> &data)
+    {
+        // only the background loop publishes, so the history and symbol table need no locking
+        static std::uint64_t next_version = 0;
+        static std::shared_ptr<const symbol_table> symbols;
+        static std::deque<std::pair<std::uint64_t, std::shared_ptr<const quote_table>>> history;
+        auto snap = std::make_shared<stocks_snapshot>();
+        snap->version = ++next_version;
+        symbols = symbol_table::with_symbols(symbols, data);
+        snap->quotes = std::make_shared<const quote_table>(quote_table::build(data, symbols));
+        const quote_table &current = *snap->quotes;
+        snap->deltas.push_back(make_delta(snap->version, snap->version, current, current));
+        for (auto it = history.rbegin(); it != history.rend(); ++it)
+            snap->deltas.push_back(make_delta(it->first, snap->version, *it->second, current));
+        history.emplace_back(snap->version, snap->quotes);
+        if (history.size() > delta_history)
+            history.pop_front();
+        static json_writer writer;
+        writer.clear();
+        writer.raw('[');
+        snap->rows.reserve(current.size());
+        for (std::size_t row = 0; row < current.size(); ++row)
+        {
+            if (row > 0)
+                writer.raw(',');
+            std::size_t start = writer.out.size();
+            write_quote(writer, current, row);
+            snap->rows.emplace_back(writer.view().substr(start));
+        }
+        writer.raw(']');
+        snap->body.assign(writer.view());
+        try
+        {
+            snap->gzip_body = gzip_compress(snap->body);
+            snap->br_body = brotli_compress(snap->body);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[stocks-bg] compression failed: " << e.what() << std::endl;
+            snap->gzip_body.clear();
+            snap->br_body.clear();
+        }
+        if (snap->gzip_body.size() >= snap->body.size())
+            snap->gzip_body.clear();
+        if (snap->br_body.size() >= snap->body.size())
+            snap->br_body.clear();
+        snap->ws_message = "{\"type\":\"snapshot\",\"version\":" + std::to_string(snap->version) +
+                           ",\"id\":\"" + version_tag(snap->version) + "\"" +
+                           ",\"provider\":\"" + stocks_provider + "\",\"refresh_seconds\":" + std::to_string(refresh_seconds) +
+                           ",\"data\":" + snap->body + "}";
+        // the JSON body never contains raw newlines, so a single data line is enough
+        snap->sse_event = "id: " + version_tag(snap->version) + "\nevent: snapshot\ndata: " + snap->body + "\n\n";
+        snap->fetched_at = std::chrono::steady_clock::now();
+        std::shared_ptr<const stocks_snapshot> published(std::move(snap));
+        std::atomic_store(&stocks_current, published);
+        broadcast_stocks(published);
+    }
+
     void stocks_background_loop()
     {
         int attempts = 0;
@@ -435,12 +639,7 @@ namespace
                 auto data = fetch_once();
                 if (!data.empty())
                 {
-                    {
-                        std::lock_guard<std::mutex> lk(stocks_mtx);
-                        stocks_cache = std::move(data);
-                        stocks_last = std::chrono::steady_clock::now();
-                        stocks_ready.store(true);
-                    }
+                    publish_stocks(data);
                     attempts = 0;
                     consecutive_failures = 0;
                 }
@@ -450,152 +649,1865 @@ namespace
                 std::cerr << "[stocks-bg] fetch error: " << e.what() << std::endl;
                 consecutive_failures++;
                 // After several failures, if we have never succeeded, expose empty list so UI stops showing 503
-                if (!stocks_ready.load() && consecutive_failures >= 5)
+                if (!std::atomic_load(&stocks_current) && consecutive_failures >= 5)
                 {
-                    std::lock_guard<std::mutex> lk(stocks_mtx);
-                    stocks_cache = nlohmann::json::array();
-                    stocks_last = std::chrono::steady_clock::now();
-                    stocks_ready.store(true);
+                    publish_stocks({});
                     std::cerr << "[stocks-bg] elevating empty cache after repeated failures" << std::endl;
                 }
             }
             // if not ready yet use shorter retry interval up to 15s, else normal refresh
-            int sleep_sec = stocks_ready.load() ? refresh_seconds : std::min(15, 2 + attempts * 2);
+            int sleep_sec = std::atomic_load(&stocks_current) ? refresh_seconds : std::min(15, 2 + attempts * 2);
             for (int i = 0; i < sleep_sec && !stocks_stop.load(); ++i)
                 std::this_thread::sleep_for(std::chrono::seconds(1));
             attempts++;
         }
     }
-}
 
-void run_http_server(unsigned short port)
-{
-    if (const char *envR = std::getenv("STOCKS_REFRESH_SECONDS"))
+    void fail(beast::error_code ec, const char *what)
     {
-        try
-        {
-            refresh_seconds = std::max(5, std::stoi(envR));
-        }
-        catch (...)
-        {
-        }
+        // peers going away mid-request are routine, don't spam the log for them
+        if (ec == net::error::operation_aborted || ec == beast::error::timeout || ec == net::error::connection_reset || ec == net::error::broken_pipe)
+            return;
+        std::cerr << "[http] " << what << ": " << ec.message() << std::endl;
     }
-    if (const char *envS = std::getenv("STOCKS_SYMBOLS"))
+
+    // Postgres work is blocking, keep it off the io threads so /orders can't stall /stocks
+    // Only database work runs here, so one thread per pooled connection keeps every connection busy.
+    net::thread_pool &blocking_pool()
     {
-        if (std::string(envS).size() > 0)
-            symbols_cfg = envS;
+        static net::thread_pool pool{static_cast<std::size_t>(pg_pool_size)};
+        return pool;
     }
-    if (const char *envP = std::getenv("STOCKS_PROVIDER"))
+
+    // Runs /orders pages too large for one batch. Their threads mostly wait on slow clients, so they
+    // are kept apart from blocking_pool(); streams past its size queue behind each other, not
+    // behind other database work.
+    net::thread_pool &stream_pool()
     {
-        std::string val = to_upper(envP);
-        if (val == "STOOQ" || val == "YAHOO" || val == "TRADING212")
-            stocks_provider = val;
-        else
-            std::cerr << "[stocks] unknown provider '" << val << "' defaulting to " << stocks_provider << "\n";
+        static net::thread_pool pool{static_cast<std::size_t>(pg_pool_size)};
+        return pool;
     }
-    if (const char *envU = std::getenv("SCRAPER_URL"))
+
+    // Keyset page of orders by id. One statement per filter combination, so each gets a plan that
+    // uses whatever index covers its predicates instead of a generic "$n IS NULL OR ..." plan.
+    std::string orders_page_sql(bool by_side, bool by_status)
     {
-        scraper_url = envU;
+        std::string sql = "SELECT id, user_id, side, price, amount, status, created_at FROM orders WHERE id > $1";
+        int param = 2;
+        if (by_side)
+            sql += " AND side = $" + std::to_string(param++);
+        if (by_status)
+            sql += " AND status = $" + std::to_string(param++);
+        sql += " ORDER BY id LIMIT $" + std::to_string(param);
+        return sql;
     }
-    std::thread bg(stocks_background_loop);
-    bg.detach();
-    try
+
+    pg_pool &orders_db()
+    {
+        static pg_pool pool{pg_conninfo, static_cast<std::size_t>(pg_pool_size), [](pqxx::connection &c)
+                            {
+                                c.prepare("orders_page", orders_page_sql(false, false));
+                                c.prepare("orders_page_side", orders_page_sql(true, false));
+                                c.prepare("orders_page_status", orders_page_sql(false, true));
+                                c.prepare("orders_page_side_status", orders_page_sql(true, true));
+                                // oldest first, so replaying them rebuilds each level's time priority; rows
+                                // from before migrations/001 kept what was left of them in amount
+                                c.prepare("orders_resting", "SELECT id, user_id, side, price, COALESCE(remaining, amount) FROM orders "
+                                                            "WHERE status IN ('open', 'partial') ORDER BY created_at, id");
+                                // ids come from the table's own sequence, which every writer shares
+                                c.prepare("orders_reserve_ids", "SELECT nextval(pg_get_serial_sequence('orders', 'id')) FROM generate_series(1, $1)");
+                                // amount is the order as entered; remaining is what is left of it, as the book keeps it
+                                c.prepare("orders_insert", "INSERT INTO orders (id, user_id, side, price, amount, remaining, status, created_at) "
+                                                           "VALUES ($1, $2, $3, $4, $5, $6, $7, now())");
+                                c.prepare("orders_update", "UPDATE orders SET remaining = $2, status = $3 WHERE id = $1"); }};
+        return pool;
+    }
+
+    // Body type that writes a shared immutable string without copying it; the pointer keeps it alive.
+    struct shared_string_body
     {
-        boost::asio::io_context ioc{1};
-        tcp::acceptor acceptor{ioc, {tcp::v4(), port}};
-        std::cout << "HTTP server listening on port " << port << " (stocks refresh=" << refresh_seconds << "s)" << std::endl;
-        for (;;)
+        using value_type = std::shared_ptr<const std::string>;
+
+        static std::uint64_t size(const value_type &body)
         {
-            tcp::socket socket{ioc};
-            acceptor.accept(socket);
+            return body ? body->size() : 0;
+        }
 
-            boost::beast::flat_buffer buffer;
-            http::request<http::string_body> req;
-            http::read(socket, buffer, req);
+        class writer
+        {
+            const value_type &body_;
 
-            http::response<http::string_body> res{http::status::ok, req.version()};
-            res.set(http::field::server, "Beast");
-            res.set("Access-Control-Allow-Origin", "*");
+        public:
+            using const_buffers_type = net::const_buffer;
 
-            // /stocks endpoint (serve cached data)
-            if (req.method() == http::verb::get && req.target() == "/stocks")
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields> &, const value_type &body) : body_(body)
             {
-                bool ready = stocks_ready.load();
-                nlohmann::json snapshot;
-                std::chrono::steady_clock::time_point ts;
-                if (ready)
-                {
-                    std::lock_guard<std::mutex> lk(stocks_mtx);
-                    snapshot = stocks_cache;
-                    ts = stocks_last;
-                }
-                if (!ready)
-                {
-                    nlohmann::json err{{"error", "initializing"}, {"message", "Stock data not yet available"}};
-                    res.result(http::status::service_unavailable);
-                    res.set(http::field::content_type, "application/json");
-                    res.body() = err.dump();
-                    res.prepare_payload();
-                    http::write(socket, res);
-                    continue;
-                }
-                auto age = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - ts).count();
-                bool stale = age > refresh_seconds * 2;
-                res.set(http::field::content_type, "application/json");
-                res.set("X-Data-Age-Seconds", std::to_string(age));
-                res.set("X-Data-Refresh-Seconds", std::to_string(refresh_seconds));
-                res.set("X-Data-Symbols", symbols_cfg);
-                res.set("X-Data-Provider", stocks_provider);
-                if (stale)
-                    res.set("X-Data-Stale", "true");
-                res.body() = snapshot.dump();
-                res.prepare_payload();
-                http::write(socket, res);
-                continue;
             }
 
-            // /orderbook endpoint
-            if (req.method() == http::verb::get && req.target() == "/orderbook")
+            void init(beast::error_code &ec)
             {
-                nlohmann::json orderbook = nlohmann::json::array();
-                try
-                {
-                    pqxx::connection c{"dbname=exchange user=leonmamic"};
-                    pqxx::work txn{c};
-                    pqxx::result r = txn.exec("SELECT id, user_id, side, price, amount, status, created_at FROM orders");
-                    for (const auto &row : r)
-                    {
-                        orderbook.push_back({{"id", row[0].as<int>()},
-                                             {"user_id", row[1].as<int>()},
-                                             {"side", row[2].as<std::string>()},
-                                             {"price", row[3].as<double>()},
-                                             {"amount", row[4].as<double>()},
-                                             {"status", row[5].as<std::string>()},
-                                             {"created_at", row[6].as<std::string>()}});
-                    }
-                }
-                catch (const std::exception &e)
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code &ec)
+            {
+                ec = {};
+                if (!body_ || body_->empty())
+                    return boost::none;
+                return {{const_buffers_type(body_->data(), body_->size()), false}};
+            }
+        };
+    };
+
+    // Producer end of a chunked response, fed from a thread other than the connection's. Each call
+    // blocks until its chunk is on the wire (or the connection has failed), so the producer never
+    // gets more than one chunk ahead of the client.
+    class chunk_sink
+    {
+    public:
+        virtual ~chunk_sink() = default;
+        // False once the connection has failed; the producer should stop.
+        virtual bool write(std::string chunk) = 0;
+        // Writes the terminating chunk with `trailers`, which should be announced in the header's Trailer field.
+        virtual bool finish(http::fields trailers) = 0;
+        // Closes the connection without terminating the body, so the client sees it as truncated.
+        virtual void abort() = 0;
+    };
+
+    std::string_view to_std(beast::string_view sv)
+    {
+        return {sv.data(), sv.size()};
+    }
+
+    // Splits a request target into path and query string (without the '?').
+    std::pair<std::string_view, std::string_view> split_target(beast::string_view target)
+    {
+        std::string_view t = to_std(target);
+        auto q = t.find('?');
+        if (q == std::string_view::npos)
+            return {t, {}};
+        return {t.substr(0, q), t.substr(q + 1)};
+    }
+
+    int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // Value of `name` in an application/x-www-form-urlencoded query, percent-decoded.
+    std::optional<std::string> query_param(std::string_view query, std::string_view name)
+    {
+        while (!query.empty())
+        {
+            auto amp = query.find('&');
+            std::string_view pair = query.substr(0, amp);
+            query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+            auto eq = pair.find('=');
+            if (pair.substr(0, eq) != name)
+                continue;
+            std::string_view raw = eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+            std::string value;
+            value.reserve(raw.size());
+            for (std::size_t i = 0; i < raw.size(); ++i)
+            {
+                if (raw[i] == '+')
+                    value.push_back(' ');
+                else if (raw[i] == '%' && i + 2 < raw.size() && hex_value(raw[i + 1]) >= 0 && hex_value(raw[i + 2]) >= 0)
                 {
-                    res.result(http::status::internal_server_error);
-                    res.set(http::field::content_type, "text/plain");
-                    res.body() = std::string("Database error: ") + e.what();
-                    res.prepare_payload();
-                    http::write(socket, res);
-                    continue;
+                    value.push_back(static_cast<char>(hex_value(raw[i + 1]) * 16 + hex_value(raw[i + 2])));
+                    i += 2;
                 }
-                res.set(http::field::content_type, "application/json");
-                res.body() = orderbook.dump();
-                res.prepare_payload();
-                http::write(socket, res);
-                continue;
+                else
+                    value.push_back(raw[i]);
+            }
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    template <class Body = http::string_body>
+    http::response<Body> make_response(unsigned version)
+    {
+        http::response<Body> res{http::status::ok, version};
+        res.set(http::field::server, "Beast");
+        res.set("Access-Control-Allow-Origin", "*");
+        return res;
+    }
+
+    template <class Body = http::string_body>
+    http::response<Body> make_response(const http::request<http::string_body> &req)
+    {
+        return make_response<Body>(req.version());
+    }
+
+    http::response<http::string_body> stocks_unavailable_response(const http::request<http::string_body> &req)
+    {
+        auto res = make_response(req);
+        nlohmann::json err{{"error", "initializing"}, {"message", "Stock data not yet available"}};
+        res.result(http::status::service_unavailable);
+        res.set(http::field::content_type, "application/json");
+        res.body() = err.dump();
+        res.prepare_payload();
+        return res;
+    }
+
+    // If-None-Match evaluation (RFC 7232 3.2): weak comparison against a list of tags, or "*".
+    bool etag_matches(std::string_view if_none_match, std::string_view etag)
+    {
+        while (!if_none_match.empty())
+        {
+            auto comma = if_none_match.find(',');
+            std::string_view tag = if_none_match.substr(0, comma);
+            if_none_match = comma == std::string_view::npos ? std::string_view{} : if_none_match.substr(comma + 1);
+            while (!tag.empty() && tag.front() == ' ')
+                tag.remove_prefix(1);
+            while (!tag.empty() && tag.back() == ' ')
+                tag.remove_suffix(1);
+            if (tag == "*")
+                return true;
+            if (tag.substr(0, 2) == "W/")
+                tag.remove_prefix(2);
+            if (tag == etag)
+                return true;
+        }
+        return false;
+    }
+
+    template <class Body>
+    void set_stocks_headers(http::response<Body> &res, const stocks_snapshot &snap)
+    {
+        auto age = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - snap.fetched_at).count();
+        bool stale = age > refresh_seconds * 2;
+        res.set(http::field::content_type, "application/json");
+        res.set("X-Data-Age-Seconds", std::to_string(age));
+        res.set("X-Data-Refresh-Seconds", std::to_string(refresh_seconds));
+        res.set("X-Data-Symbols", symbols_cfg);
+        res.set("X-Data-Provider", stocks_provider);
+        if (stale)
+            res.set("X-Data-Stale", "true");
+    }
+
+    // /stocks?since=<id>, where id is the "id" of a snapshot or delta envelope: the precomputed
+    // change set, or the full snapshot envelope when `since` is outside the retained history or
+    // from before a restart (parse_version_tag makes that version 0).
+    http::response<shared_string_body> stocks_since_response(const http::request<http::string_body> &req,
+                                                             const std::shared_ptr<const stocks_snapshot> &snap,
+                                                             std::uint64_t since)
+    {
+        auto res = make_response<shared_string_body>(req);
+        set_stocks_headers(res, *snap);
+        res.set(http::field::cache_control, "no-cache");
+        const stocks_delta *delta = snap->delta_from(since);
+        res.body() = shared_string_body::value_type(snap, delta ? &delta->message : &snap->ws_message);
+        res.prepare_payload();
+        return res;
+    }
+
+    // /stocks?symbols=AAPL,MSFT: stitches the requested rows' pre-serialized JSON together.
+    // Unknown symbols are skipped; the order follows the query.
+    http::response<http::string_body> stocks_filtered_response(const http::request<http::string_body> &req,
+                                                               const stocks_snapshot &snap,
+                                                               std::string_view symbols)
+    {
+        auto res = make_response(req);
+        set_stocks_headers(res, snap);
+        res.set(http::field::cache_control, "no-cache");
+        std::vector<std::size_t> picked;
+        while (!symbols.empty())
+        {
+            auto comma = symbols.find(',');
+            std::string sym;
+            for (char c : symbols.substr(0, comma))
+            {
+                if (!isspace(static_cast<unsigned char>(c)))
+                    sym.push_back(static_cast<char>(::toupper(static_cast<unsigned char>(c))));
             }
+            symbols = comma == std::string_view::npos ? std::string_view{} : symbols.substr(comma + 1);
+            std::int32_t row = snap.quotes->find(sym);
+            if (row >= 0 && std::find(picked.begin(), picked.end(), static_cast<std::size_t>(row)) == picked.end())
+                picked.push_back(static_cast<std::size_t>(row));
+        }
+        std::string &body = res.body();
+        std::size_t len = 2;
+        for (auto slot : picked)
+            len += snap.rows[slot].size() + 1;
+        body.reserve(len);
+        body += '[';
+        for (std::size_t i = 0; i < picked.size(); ++i)
+        {
+            if (i)
+                body += ',';
+            body += snap.rows[picked[i]];
+        }
+        body += ']';
+        res.prepare_payload();
+        return res;
+    }
 
-            // Default response
-            res.set(http::field::content_type, "text/plain");
-            res.body() = "Hello, world!";
+    http::response<shared_string_body> stocks_response(const http::request<http::string_body> &req,
+                                                       const std::shared_ptr<const stocks_snapshot> &snap)
+    {
+        auto res = make_response<shared_string_body>(req);
+        set_stocks_headers(res, *snap);
+        res.set(http::field::vary, "Accept-Encoding");
+        // let browsers cache the body but revalidate every poll, which turns unchanged polls into 304s
+        res.set(http::field::cache_control, "no-cache");
+        const std::string *body = &snap->body;
+        const char *coding = nullptr;
+        switch (negotiate_coding(to_std(req[http::field::accept_encoding]), !snap->br_body.empty(), !snap->gzip_body.empty()))
+        {
+        case content_coding::br:
+            body = &snap->br_body;
+            coding = "br";
+            break;
+        case content_coding::gzip:
+            body = &snap->gzip_body;
+            coding = "gzip";
+            break;
+        case content_coding::identity:
+            break;
+        case content_coding::none:
+            res.result(http::status::not_acceptable);
             res.prepare_payload();
-            http::write(socket, res);
+            return res;
+        }
+        // each coding is a distinct representation, so it gets its own strong tag; the epoch keeps a
+        // tag cached from an earlier run from matching this run's same-numbered version
+        std::string etag = "\"" + version_tag(snap->version) + (coding ? std::string("-") + coding : "") + "\"";
+        res.set(http::field::etag, etag);
+        if (etag_matches(to_std(req[http::field::if_none_match]), etag))
+        {
+            res.result(http::status::not_modified);
+            return res;
         }
+        if (coding)
+            res.set(http::field::content_encoding, coding);
+        res.body() = shared_string_body::value_type(snap, body);
+        res.prepare_payload();
+        return res;
+    }
+
+    constexpr int orders_default_limit = 500;
+    constexpr int orders_max_limit = 100000; // pages past orders_fetch_rows are streamed, so this only bounds query time
+    constexpr int orders_fetch_rows = 1000;
+
+    // /orders?limit=&after_id=&side=&status=
+    struct orders_query
+    {
+        int limit = orders_default_limit;
+        int after_id = 0; // ids are serial, so 0 starts from the beginning
+        std::optional<std::string> side;
+        std::optional<std::string> status;
+    };
+
+    bool parse_int(const std::string &s, int &out)
+    {
+        auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc{} && end == s.data() + s.size();
+    }
+
+    // nullopt when limit or after_id isn't a number in range.
+    std::optional<orders_query> parse_orders_query(std::string_view query)
+    {
+        orders_query q;
+        if (auto limit = query_param(query, "limit"))
+        {
+            if (!parse_int(*limit, q.limit) || q.limit < 1 || q.limit > orders_max_limit)
+                return std::nullopt;
+        }
+        if (auto after = query_param(query, "after_id"))
+        {
+            if (!parse_int(*after, q.after_id) || q.after_id < 0)
+                return std::nullopt;
+        }
+        q.side = query_param(query, "side");
+        q.status = query_param(query, "status");
+        return q;
+    }
+
+    http::response<http::string_body> orders_bad_request(const http::request<http::string_body> &req, const std::string &message)
+    {
+        auto res = make_response(req);
+        nlohmann::json err{{"error", "bad_request"}, {"message", message}};
+        res.result(http::status::bad_request);
+        res.set(http::field::content_type, "application/json");
+        res.body() = err.dump();
+        res.prepare_payload();
+        return res;
+    }
+
+    // Calls f with the bind parameters of the orders_page* statement matching q's filters.
+    template <class F>
+    auto with_page_params(const orders_query &q, F &&f)
+    {
+        if (q.side && q.status)
+            return f(q.after_id, *q.side, *q.status, q.limit);
+        if (q.side)
+            return f(q.after_id, *q.side, q.limit);
+        if (q.status)
+            return f(q.after_id, *q.status, q.limit);
+        return f(q.after_id, q.limit);
+    }
+
+    const char *orders_page_statement(const orders_query &q)
+    {
+        if (q.side && q.status)
+            return "orders_page_side_status";
+        if (q.side)
+            return "orders_page_side";
+        return q.status ? "orders_page_status" : "orders_page";
+    }
+
+    // nullopt, and logged, when the row's price or amount isn't one the book can hold (finer than
+    // its decimals, NUMERIC NaN, out of range), so one bad row can't fail a whole page.
+    std::optional<order_record> read_order(const pqxx::row &row)
+    {
+        order_record o;
+        o.id = row[0].as<int>();
+        o.user_id = row[1].as<int>();
+        o.side = row[2].as<std::string>();
+        // decoded from the column text, so no value passes through a double on its way out; a
+        // market order has no price of its own
+        auto price = row[3].is_null() ? std::optional<price_ticks>(price_ticks()) : book_instrument.parse_price(row[3].c_str());
+        auto amount = book_instrument.parse_amount(row[4].c_str());
+        if (!price || !amount)
+        {
+            std::cerr << "[orders] skipping order " << o.id << ": price " << row[3].c_str() << " or amount " << row[4].c_str()
+                      << " doesn't fit the book's decimals" << std::endl;
+            return std::nullopt;
+        }
+        o.price = *price;
+        o.amount = *amount;
+        o.status = row[5].as<std::string>();
+        o.created_at = row[6].as<std::string>();
+        return o;
+    }
+
+    http::response<http::string_body> orders_error_response(const http::request<http::string_body> &req, const std::exception &e)
+    {
+        auto res = make_response(req);
+        res.result(http::status::internal_server_error);
+        res.set(http::field::content_type, "text/plain");
+        res.body() = std::string("Database error: ") + e.what();
+        res.prepare_payload();
+        return res;
+    }
+
+    // `body` is the whole page, already serialized. A full page sets X-Next-After-Id to the id to continue after.
+    http::response<http::string_body> orders_page_response(const http::request<http::string_body> &req, const orders_query &q,
+                                                              std::string body, int rows, int last_id)
+    {
+        auto res = make_response(req);
+        res.set(http::field::content_type, "application/json");
+        res.set("Access-Control-Expose-Headers", "X-Next-After-Id");
+        if (rows == q.limit)
+            res.set("X-Next-After-Id", std::to_string(last_id));
+        res.body() = std::move(body);
+        res.prepare_payload();
+        return res;
+    }
+
+    // Whether orders_stream() sends this page in chunks rather than through orders_response().
+    bool orders_streamed(const http::request<http::string_body> &req, const orders_query &q)
+    {
+        return q.limit > orders_fetch_rows && req.version() >= 11;
+    }
+
+    // One page of orders in id order, read with a single prepared statement.
+    http::response<http::string_body> orders_response(const http::request<http::string_body> &req, const orders_query &q)
+    {
+        std::vector<order_record> orders;
+        int rows = 0; // read, including any skipped, so paging still continues after them
+        int last_id = 0;
+        try
+        {
+            pqxx::result r = orders_db().run([&q](pqxx::connection &c)
+                                             {
+                pqxx::read_transaction txn{c};
+                return with_page_params(q, [&](const auto &...params)
+                                        { return txn.exec_prepared(orders_page_statement(q), params...); }); });
+            orders.reserve(r.size());
+            for (const auto &row : r)
+            {
+                if (auto o = read_order(row))
+                    orders.push_back(std::move(*o));
+                last_id = row[0].as<int>();
+            }
+            rows = static_cast<int>(r.size());
+        }
+        catch (const std::exception &e)
+        {
+            return orders_error_response(req, e);
+        }
+        json_writer writer;
+        writer.out.reserve(orders.size() * 128);
+        write_orders(writer, book_instrument, orders);
+        return orders_page_response(req, q, std::move(writer.out), rows, last_id);
+    }
+
+    // Pages that fit in one batch of orders_fetch_rows are answered by orders_response. Larger ones
+    // are read one batch at a time, each a keyset query continuing after the last id sent, and
+    // written as one HTTP chunk per batch, so memory stays flat however big `limit` is and the first
+    // rows go out before the last are read. A connection is only leased for each query, never while
+    // a chunk waits on the client. The header leaves before the page is known to be full, so
+    // X-Next-After-Id moves to a trailer; clients that can't read trailers continue after the last
+    // id they received. HTTP/1.0 has no chunked encoding, so those clients get the page buffered.
+    template <class Send>
+    void orders_stream(const http::request<http::string_body> &req, const orders_query &q, Send &send)
+    {
+        if (!orders_streamed(req, q))
+            return send(orders_response(req, q));
+        std::shared_ptr<chunk_sink> sink;
+        try
+        {
+            orders_query batch = q; // the same filters, advancing after_id
+            json_writer writer;
+            int rows = 0; // read, including any read_order skipped
+            int written = 0;
+            int last_id = 0;
+            for (;;)
+            {
+                batch.limit = std::min(orders_fetch_rows, q.limit - rows);
+                pqxx::result r = orders_db().run([&batch](pqxx::connection &c)
+                                                 {
+                    pqxx::read_transaction txn{c};
+                    return with_page_params(batch, [&](const auto &...params)
+                                            { return txn.exec_prepared(orders_page_statement(batch), params...); }); });
+                writer.clear();
+                for (const auto &row : r)
+                {
+                    ++rows;
+                    last_id = row[0].as<int>();
+                    if (auto o = read_order(row))
+                    {
+                        writer.raw(written++ == 0 ? '[' : ',');
+                        write_order(writer, book_instrument, *o);
+                    }
+                }
+                bool done = static_cast<int>(r.size()) < batch.limit || rows == q.limit;
+                if (done)
+                    writer.raw(written == 0 ? "[]" : "]");
+                if (done && !sink)
+                    return send(orders_page_response(req, q, std::move(writer.out), rows, last_id)); // fit in one batch after all
+                if (!sink)
+                {
+                    http::response<http::empty_body> header{http::status::ok, req.version()};
+                    header.set(http::field::server, "Beast");
+                    header.set("Access-Control-Allow-Origin", "*");
+                    header.set("Access-Control-Expose-Headers", "X-Next-After-Id");
+                    header.set(http::field::content_type, "application/json");
+                    header.set(http::field::trailer, "X-Next-After-Id");
+                    sink = send.chunked(std::move(header));
+                }
+                if (!sink->write(std::move(writer.out)))
+                    return; // client went away
+                writer.out = {};
+                if (done)
+                {
+                    http::fields trailers;
+                    if (rows == q.limit)
+                        trailers.set("X-Next-After-Id", std::to_string(last_id));
+                    sink->finish(std::move(trailers));
+                    return;
+                }
+                batch.after_id = last_id;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            if (!sink)
+                return send(orders_error_response(req, e));
+            std::cerr << "[orders] stream aborted: " << e.what() << std::endl;
+            sink->abort();
+        }
+    }
+
+    // Aggregated depth of the in-memory book, published whole like stocks_snapshot.
+    struct book_snapshot
+    {
+        std::uint64_t version = 0;
+        std::vector<level_view> bids;
+        std::vector<level_view> asks;
+        std::string body; // every level, pre-serialized
+    };
+
+    // Swapped with std::atomic_store/atomic_load; null until the resting orders are loaded.
+    std::shared_ptr<const book_snapshot> book_current;
+
+    // Only the engine thread touches the engine itself; everyone else reads book_current.
+    matching_engine live_engine;
+
+    void publish_book()
+    {
+        static std::uint64_t next_version = 0;
+        auto snap = std::make_shared<book_snapshot>();
+        snap->version = ++next_version;
+        snap->bids = live_engine.book().bids();
+        snap->asks = live_engine.book().asks();
+        json_writer writer;
+        write_book(writer, book_instrument, snap->bids, snap->asks);
+        snap->body = std::move(writer.out);
+        std::atomic_store(&book_current, std::shared_ptr<const book_snapshot>(std::move(snap)));
+    }
+
+    // Fills live_engine's book from the open orders in Postgres, retrying until the database answers.
+    void load_book()
+    {
+        while (!stocks_stop.load())
+        {
+            try
+            {
+                pqxx::result r = orders_db().run([](pqxx::connection &c)
+                                                 {
+                    pqxx::read_transaction txn{c};
+                    return txn.exec_prepared("orders_resting"); });
+                std::size_t skipped = 0;
+                for (const auto &row : r)
+                {
+                    auto side = parse_order_side(row[2].as<std::string>());
+                    auto price = book_instrument.parse_price(row[3].c_str());
+                    auto amount = book_instrument.parse_amount(row[4].c_str());
+                    if (!side || !price || !amount || !live_engine.restore({row[0].as<int>(), row[1].as<int>(), *side, *price, *amount}))
+                    {
+                        std::cerr << "[book] skipping resting order " << row[0].c_str() << ": side " << row[2].c_str() << ", price "
+                                  << row[3].c_str() << ", amount " << row[4].c_str() << std::endl;
+                        ++skipped;
+                    }
+                }
+                publish_book();
+                std::cerr << "[book] loaded " << live_engine.book().size() << " resting orders (" << skipped << " skipped)" << std::endl;
+                return;
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[book] load failed: " << e.what() << std::endl;
+            }
+            for (int i = 0; i < 5 && !stocks_stop.load(); ++i)
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    // A POST or DELETE /orders on its way to the engine thread.
+    struct engine_command
+    {
+        bool cancel = false;
+        order_request order; // a cancel only uses the id
+        std::chrono::steady_clock::time_point queued_at;
+        // Runs on the engine thread with the result and the time since queued_at.
+        std::function<void(const match_result &, std::chrono::steady_clock::duration)> done;
+    };
+
+    constexpr std::size_t engine_queue_capacity = 65536;
+    constexpr int engine_spin_limit = 2000; // idle polls before the engine thread parks
+
+    mpsc_queue<engine_command> engine_queue{engine_queue_capacity};
+    std::mutex engine_mtx;
+    std::condition_variable engine_cv;
+    std::atomic<bool> engine_parked{false};
+
+    // Any thread. False when the queue is full.
+    bool enqueue_command(engine_command &&cmd)
+    {
+        if (!engine_queue.try_push(std::move(cmd)))
+            return false;
+        // pairs with the fence in engine_loop: either we see it parked or it sees our command
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (engine_parked.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(engine_mtx);
+            engine_cv.notify_one();
+        }
+        return true;
+    }
+
+    // Engine results not yet written back to Postgres, in the order the engine produced them.
+    struct persist_job
+    {
+        bool insert = false; // a new order row; otherwise only remaining and status change
+        order_record row;    // amount is the order as entered
+        qty_lots remaining;
+        bool has_price = true; // false for market orders, which have no price of their own
+    };
+
+    std::mutex persist_mtx;
+    std::condition_variable persist_cv;
+    std::vector<persist_job> persist_pending;
+
+    // Ids for POST /orders, reserved from the orders id sequence a block at a time by the persist
+    // thread, so they can't collide with ids other writers (or other instances) take from it.
+    constexpr std::size_t order_id_block = 4096;
+    std::mutex order_ids_mtx;
+    std::deque<int> order_ids;
+    std::atomic<bool> order_ids_wanted{true}; // fewer than half a block left
+
+    // Any thread. nullopt when none are reserved, i.e. Postgres hasn't answered since startup or
+    // order entry has outrun the reservations.
+    std::optional<int> take_order_id()
+    {
+        std::optional<int> id;
+        bool low = false;
+        {
+            std::lock_guard<std::mutex> lock(order_ids_mtx);
+            if (!order_ids.empty())
+            {
+                id = order_ids.front();
+                order_ids.pop_front();
+            }
+            low = order_ids.size() < order_id_block / 2;
+        }
+        if (low && !order_ids_wanted.exchange(true))
+        {
+            std::lock_guard<std::mutex> lock(persist_mtx);
+            persist_cv.notify_one();
+        }
+        return id;
+    }
+
+    // Persist thread. Tops order_ids up by a block when take_order_id() asked for more.
+    void reserve_order_ids()
+    {
+        if (!order_ids_wanted.load())
+            return;
+        try
+        {
+            pqxx::result r = orders_db().run([](pqxx::connection &c)
+                                             {
+                pqxx::work txn{c};
+                pqxx::result ids = txn.exec_prepared("orders_reserve_ids", static_cast<int>(order_id_block));
+                txn.commit();
+                return ids; });
+            std::lock_guard<std::mutex> lock(order_ids_mtx);
+            for (const auto &row : r)
+                order_ids.push_back(row[0].as<int>());
+            order_ids_wanted.store(order_ids.size() < order_id_block / 2);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[persist] reserving order ids failed: " << e.what() << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1)); // don't spin while Postgres is away
+        }
+    }
+
+    void persist_result(const engine_command &cmd, const match_result &r)
+    {
+        if (!r.accepted)
+            return;
+        std::lock_guard<std::mutex> lock(persist_mtx);
+        for (const auto &u : r.updates)
+        {
+            persist_job job;
+            job.row.id = u.id;
+            job.remaining = u.remaining;
+            job.row.status = to_string(u.status);
+            if (!cmd.cancel && u.id == cmd.order.id)
+            {
+                job.insert = true;
+                job.row.user_id = cmd.order.user_id;
+                job.row.side = to_string(cmd.order.side);
+                job.row.price = cmd.order.price;
+                job.row.amount = cmd.order.amount;
+                job.has_price = cmd.order.type == order_type::limit;
+            }
+            persist_pending.push_back(std::move(job));
+        }
+        persist_cv.notify_one();
+    }
+
+    void write_job(pqxx::work &txn, const persist_job &job)
+    {
+        const order_record &o = job.row;
+        if (job.insert)
+            txn.exec_prepared("orders_insert", o.id, o.user_id, o.side,
+                              job.has_price ? std::optional<std::string>(book_instrument.format(o.price)) : std::nullopt,
+                              book_instrument.format(o.amount), book_instrument.format(job.remaining), o.status);
+        else
+            txn.exec_prepared("orders_update", o.id, book_instrument.format(job.remaining), o.status);
+    }
+
+    // Errors that come from a row's contents, so writing that row again can't succeed. Anything
+    // else (a dropped connection, pg_pool_timeout) is worth retrying as it is.
+    bool row_refused(const std::exception &e)
+    {
+        return dynamic_cast<const pqxx::data_exception *>(&e) || dynamic_cast<const pqxx::integrity_constraint_violation *>(&e);
+    }
+
+    // Writes engine results behind the engine, one transaction per batch, so order entry never
+    // waits on Postgres. Changes are only given up when Postgres refuses the row itself: a refused
+    // batch is written again one change per transaction, and the changes refused on their own are
+    // logged and dropped. Every other failure keeps the whole batch and retries it, with whatever
+    // the engine queued meanwhile appended behind it.
+    void persist_loop()
+    {
+        std::vector<persist_job> batch;
+        bool one_by_one = false;
+        while (!stocks_stop.load())
+        {
+            {
+                std::unique_lock<std::mutex> lock(persist_mtx);
+                persist_cv.wait_for(lock, std::chrono::milliseconds(200), []
+                                    { return !persist_pending.empty() || order_ids_wanted.load(); });
+                batch.insert(batch.end(), std::make_move_iterator(persist_pending.begin()), std::make_move_iterator(persist_pending.end()));
+                persist_pending.clear();
+            }
+            reserve_order_ids();
+            if (batch.empty())
+                continue;
+            std::size_t written = 0;
+            try
+            {
+                if (!one_by_one)
+                {
+                    orders_db().run([&batch](pqxx::connection &c)
+                                    {
+                        pqxx::work txn{c};
+                        for (const auto &job : batch)
+                            write_job(txn, job);
+                        txn.commit(); });
+                    written = batch.size();
+                }
+                for (; written < batch.size(); ++written)
+                {
+                    const persist_job &job = batch[written];
+                    try
+                    {
+                        orders_db().run([&job](pqxx::connection &c)
+                                        {
+                            pqxx::work txn{c};
+                            write_job(txn, job);
+                            txn.commit(); });
+                    }
+                    catch (const std::exception &e)
+                    {
+                        if (!row_refused(e))
+                            throw;
+                        std::cerr << "[persist] dropping " << (job.insert ? "insert" : "update") << " of order " << job.row.id
+                                  << " (status " << job.row.status << "): " << e.what() << std::endl;
+                    }
+                }
+                batch.clear();
+                one_by_one = false;
+            }
+            catch (const std::exception &e)
+            {
+                batch.erase(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(written));
+                if (row_refused(e))
+                {
+                    std::cerr << "[persist] batch of " << batch.size() << " changes refused, writing them one by one: " << e.what() << std::endl;
+                    one_by_one = true;
+                    continue;
+                }
+                std::cerr << "[persist] writing " << batch.size() << " changes failed, will retry: " << e.what() << std::endl;
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+    }
+
+    // The only thread that touches live_engine: loads the book, then applies queued commands in
+    // arrival order. Spins briefly after work so a steady flow sees microsecond hand-offs, then
+    // parks until a producer wakes it.
+    void engine_loop()
+    {
+        load_book();
+        engine_command cmd;
+        int spins = 0;
+        while (!stocks_stop.load())
+        {
+            bool applied = false;
+            for (int n = 0; n < 1024 && engine_queue.try_pop(cmd); ++n)
+            {
+                const match_result &r = cmd.cancel ? live_engine.cancel(cmd.order.id) : live_engine.submit(cmd.order);
+                cmd.done(r, std::chrono::steady_clock::now() - cmd.queued_at);
+                persist_result(cmd, r);
+                cmd.done = nullptr;
+                applied = true;
+            }
+            if (applied)
+            {
+                publish_book(); // once per drained batch, not per command
+                spins = 0;
+                continue;
+            }
+            if (spins < engine_spin_limit)
+            {
+                ++spins;
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(engine_mtx);
+            engine_parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            engine_cv.wait_for(lock, std::chrono::milliseconds(100), []
+                               { return !engine_queue.empty(); });
+            engine_parked.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    http::response<http::string_body> book_unavailable_response(const http::request<http::string_body> &req,
+                                                                const char *message = "Order book not yet loaded")
+    {
+        auto res = make_response(req);
+        nlohmann::json err{{"error", "initializing"}, {"message", message}};
+        res.result(http::status::service_unavailable);
+        res.set(http::field::content_type, "application/json");
+        res.body() = err.dump();
+        res.prepare_payload();
+        return res;
+    }
+
+    // /orderbook[?depth=N]: the full book straight from the snapshot, or its top N levels a side.
+    http::response<shared_string_body> book_response(const http::request<http::string_body> &req,
+                                                     const std::shared_ptr<const book_snapshot> &snap, std::size_t depth)
+    {
+        auto res = make_response<shared_string_body>(req);
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "no-cache");
+        if (depth >= snap->bids.size() && depth >= snap->asks.size())
+        {
+            res.body() = shared_string_body::value_type(snap, &snap->body);
+        }
+        else
+        {
+            json_writer writer;
+            write_book(writer, book_instrument, snap->bids, snap->asks, depth);
+            res.body() = std::make_shared<const std::string>(std::move(writer.out));
+        }
+        res.prepare_payload();
+        return res;
+    }
+
+    // POST /orders body: {"user_id":N,"side":"buy"|"sell","type":"limit"|"market","price":P,"amount":A}.
+    // type defaults to limit and price is required only for limit orders. Fills o (except the id)
+    // and returns an empty string, or says what is wrong.
+    std::string parse_order_request(const std::string &body, order_request &o)
+    {
+        auto j = nlohmann::json::parse(body, nullptr, false);
+        if (j.is_discarded() || !j.is_object())
+            return "body must be a JSON object";
+        auto user = j.find("user_id");
+        if (user == j.end() || !user->is_number_integer() || user->get<std::int64_t>() < 1 || user->get<std::int64_t>() > INT_MAX)
+            return "user_id must be a positive integer";
+        o.user_id = user->get<int>();
+        auto side = j.find("side");
+        std::optional<order_side> s;
+        if (side != j.end() && side->is_string())
+            s = parse_order_side(side->get_ref<const std::string &>());
+        if (!s)
+            return "side must be \"buy\" or \"sell\"";
+        o.side = *s;
+        o.type = order_type::limit;
+        if (auto type = j.find("type"); type != j.end())
+        {
+            if (*type == "market")
+                o.type = order_type::market;
+            else if (*type != "limit")
+                return "type must be \"limit\" or \"market\"";
+        }
+        // JSON numbers arrive as doubles; converting to ticks and lots here is the only rounding
+        // an order ever sees
+        auto number = [&j](const char *key) -> std::optional<double>
+        {
+            auto v = j.find(key);
+            if (v == j.end() || !v->is_number())
+                return std::nullopt;
+            return v->get<double>();
+        };
+        o.price = price_ticks();
+        if (o.type == order_type::limit)
+        {
+            auto v = number("price");
+            auto price = v ? book_instrument.price_from(*v) : std::nullopt;
+            if (!price || *price <= price_ticks())
+                return "price must be a positive multiple of " + format_decimal(1, book_instrument.price_decimals) + " for limit orders";
+            o.price = *price;
+        }
+        auto v = number("amount");
+        auto amount = v ? book_instrument.amount_from(*v) : std::nullopt;
+        if (!amount || *amount <= qty_lots())
+            return "amount must be a positive multiple of " + format_decimal(1, book_instrument.amount_decimals);
+        o.amount = *amount;
+        return {};
+    }
+
+    // What the engine did with one command: {"id","sequence","status","remaining","fills":[...]},
+    // with the time it spent queued and matching in Server-Timing.
+    http::response<http::string_body> order_ack_response(unsigned version, bool cancel, int id, const match_result &r,
+                                                         std::chrono::steady_clock::duration took)
+    {
+        const order_update *own = nullptr;
+        for (const auto &u : r.updates)
+            if (u.id == id)
+                own = &u;
+        json_writer w;
+        w.raw("{\"id\":");
+        w.number(std::int64_t{id});
+        w.raw(",\"sequence\":");
+        w.number(static_cast<std::int64_t>(r.sequence));
+        w.raw(",\"status\":");
+        w.string(own ? to_string(own->status) : to_string(order_status::rejected));
+        w.raw(",\"remaining\":");
+        w.decimal(own ? own->remaining.units : 0, book_instrument.amount_decimals);
+        w.raw(",\"fills\":[");
+        for (std::size_t i = 0; i < r.fills.size(); ++i)
+        {
+            const fill &f = r.fills[i];
+            w.raw(i ? ",{\"maker_id\":" : "{\"maker_id\":");
+            w.number(std::int64_t{f.maker_id});
+            w.raw(",\"price\":");
+            w.decimal(f.price.units, book_instrument.price_decimals);
+            w.raw(",\"amount\":");
+            w.decimal(f.amount.units, book_instrument.amount_decimals);
+            w.raw('}');
+        }
+        w.raw("]}");
+
+        auto res = make_response(version);
+        if (cancel)
+            res.result(r.accepted ? http::status::ok : http::status::not_found);
+        else
+            res.result(r.accepted ? http::status::created : http::status::conflict);
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "no-store");
+        char timing[48];
+        std::snprintf(timing, sizeof timing, "engine;dur=%.3f", std::chrono::duration<double, std::milli>(took).count());
+        res.set("Server-Timing", timing);
+        res.body() = std::move(w.out);
+        res.prepare_payload();
+        return res;
+    }
+
+    http::response<http::string_body> engine_busy_response(const http::request<http::string_body> &req)
+    {
+        auto res = make_response(req);
+        nlohmann::json err{{"error", "busy"}, {"message", "Too many orders in flight, retry shortly"}};
+        res.result(http::status::service_unavailable);
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::retry_after, "1");
+        res.body() = err.dump();
+        res.prepare_payload();
+        return res;
+    }
+
+    // Queues a command for the engine thread, which answers through `send` once it has run it.
+    template <class Send>
+    void submit_command(const http::request<http::string_body> &req, bool cancel, const order_request &o, Send &&send)
+    {
+        engine_command cmd;
+        cmd.cancel = cancel;
+        cmd.order = o;
+        cmd.queued_at = std::chrono::steady_clock::now();
+        cmd.done = [send, version = req.version(), cancel, id = o.id](const match_result &r, std::chrono::steady_clock::duration took)
+        { send(order_ack_response(version, cancel, id, r, took)); };
+        if (!enqueue_command(std::move(cmd)))
+            send(engine_busy_response(req));
+    }
+
+    // Routes a request and hands the response to `send`, which may be invoked from any thread.
+    template <class Send>
+    void handle_request(http::request<http::string_body> &&req, Send &&send)
+    {
+        auto [path, query] = split_target(req.target());
+
+        // /stocks endpoint (serve cached data)
+        if (req.method() == http::verb::get && path == "/stocks")
+        {
+            auto snap = std::atomic_load(&stocks_current);
+            if (!snap)
+                return send(stocks_unavailable_response(req));
+            if (auto since = query_param(query, "since"))
+            {
+                std::uint64_t from = 0;
+                if (!parse_version_tag(*since, from))
+                    return send(orders_bad_request(req, "since must be the id of an earlier snapshot or delta"));
+                return send(stocks_since_response(req, snap, from));
+            }
+            if (auto symbols = query_param(query, "symbols"))
+                return send(stocks_filtered_response(req, *snap, *symbols));
+            return send(stocks_response(req, snap));
+        }
+
+        // /orderbook endpoint (aggregated levels of the in-memory book)
+        if (req.method() == http::verb::get && path == "/orderbook")
+        {
+            auto book = std::atomic_load(&book_current);
+            if (!book)
+                return send(book_unavailable_response(req));
+            std::size_t depth = SIZE_MAX;
+            if (auto d = query_param(query, "depth"))
+            {
+                int n = 0;
+                if (!parse_int(*d, n) || n < 1)
+                    return send(orders_bad_request(req, "depth must be a positive integer"));
+                depth = static_cast<std::size_t>(n);
+            }
+            return send(book_response(req, book, depth));
+        }
+
+        // /orders endpoint (order rows straight from Postgres)
+        if (req.method() == http::verb::get && path == "/orders")
+        {
+            auto q = parse_orders_query(query);
+            if (!q)
+                return send(orders_bad_request(req, "limit must be 1-" + std::to_string(orders_max_limit) + " and after_id a non-negative integer"));
+            // a streamed page spends most of its time waiting on the client, so it gets threads of its own
+            net::post(orders_streamed(req, *q) ? stream_pool() : blocking_pool(),
+                      [req = std::move(req), q = std::move(*q), send = std::forward<Send>(send)]() mutable
+                      { orders_stream(req, q, send); });
+            return;
+        }
+
+        // POST /orders, DELETE /orders/{id}: order entry through the matching engine
+        if (req.method() == http::verb::post && path == "/orders")
+        {
+            if (!std::atomic_load(&book_current))
+                return send(book_unavailable_response(req));
+            order_request o;
+            if (auto error = parse_order_request(req.body(), o); !error.empty())
+                return send(orders_bad_request(req, error));
+            auto id = take_order_id();
+            if (!id)
+                return send(book_unavailable_response(req, "No order ids reserved yet"));
+            o.id = *id;
+            return submit_command(req, false, o, send);
+        }
+        if (req.method() == http::verb::delete_ && path.substr(0, 8) == "/orders/")
+        {
+            if (!std::atomic_load(&book_current))
+                return send(book_unavailable_response(req));
+            order_request o;
+            if (!parse_int(std::string(path.substr(8)), o.id) || o.id < 1)
+                return send(orders_bad_request(req, "order id must be a positive integer"));
+            return submit_command(req, true, o, send);
+        }
+        if (req.method() == http::verb::options && (path == "/orders" || path.substr(0, 8) == "/orders/"))
+        {
+            auto res = make_response(req);
+            res.result(http::status::no_content);
+            res.set(http::field::access_control_allow_methods, "GET, POST, DELETE, OPTIONS");
+            res.set(http::field::access_control_allow_headers, "Content-Type");
+            res.set(http::field::access_control_max_age, "600");
+            return send(std::move(res));
+        }
+
+        // Default response
+        auto res = make_response(req);
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "Hello, world!";
+        res.prepare_payload();
+        send(std::move(res));
+    }
+
+    // Pushes the current snapshot on connect, then every refresh; client frames are read and ignored.
+    class websocket_session : public stream_subscriber, public std::enable_shared_from_this<websocket_session>
+    {
+        websocket::stream<beast::tcp_stream> ws_;
+        beast::flat_buffer buffer_;
+        std::deque<std::shared_ptr<const std::string>> queue_;
+        std::uint64_t last_version_ = 0;
+
+    public:
+        explicit websocket_session(tcp::socket &&socket) : ws_(std::move(socket)) {}
+
+        ~websocket_session()
+        {
+            unsubscribe(this);
+        }
+
+        void run(http::request<http::string_body> req)
+        {
+            beast::get_lowest_layer(ws_).expires_never();
+            ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+            ws_.set_option(websocket::stream_base::decorator([](websocket::response_type &res)
+                                                             { res.set(http::field::server, "Beast"); }));
+            ws_.text(true);
+            ws_.async_accept(req, beast::bind_front_handler(&websocket_session::on_accept, shared_from_this()));
+        }
+
+        void push(const std::shared_ptr<const stocks_snapshot> &snap) override
+        {
+            net::post(ws_.get_executor(), beast::bind_front_handler(&websocket_session::on_push, shared_from_this(), snap));
+        }
+
+    private:
+        void on_accept(beast::error_code ec)
+        {
+            if (ec)
+                return fail(ec, "ws accept");
+            if (auto snap = subscribe(shared_from_this()))
+                on_push(snap);
+            do_read();
+        }
+
+        void do_read()
+        {
+            ws_.async_read(buffer_, beast::bind_front_handler(&websocket_session::on_read, shared_from_this()));
+        }
+
+        void on_read(beast::error_code ec, std::size_t)
+        {
+            if (ec == websocket::error::closed)
+                return;
+            if (ec)
+                return fail(ec, "ws read");
+            buffer_.consume(buffer_.size());
+            do_read();
+        }
+
+        void on_push(std::shared_ptr<const stocks_snapshot> snap)
+        {
+            // a subscribe racing with a publish can deliver the same snapshot twice
+            if (snap->version <= last_version_)
+                return;
+            if (queue_.size() >= max_pending_frames)
+            {
+                std::cerr << "[ws] dropping slow subscriber" << std::endl;
+                beast::get_lowest_layer(ws_).close();
+                return;
+            }
+            // after the first frame only changes are sent, unless this session fell out of the history
+            const stocks_delta *delta = last_version_ ? snap->delta_from(last_version_) : nullptr;
+            last_version_ = snap->version;
+            queue_.push_back(std::shared_ptr<const std::string>(snap, delta ? &delta->message : &snap->ws_message));
+            if (queue_.size() == 1)
+                do_write();
+        }
+
+        void do_write()
+        {
+            ws_.async_write(net::buffer(*queue_.front()), beast::bind_front_handler(&websocket_session::on_write, shared_from_this()));
+        }
+
+        void on_write(beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                return fail(ec, "ws write");
+            queue_.pop_front();
+            if (!queue_.empty())
+                do_write();
+        }
+    };
+
+    // text/event-stream feed for clients without WebSocket support. Every subscriber writes the
+    // snapshot's shared sse_event buffer, so nothing is serialized per client.
+    class sse_session : public stream_subscriber, public std::enable_shared_from_this<sse_session>
+    {
+        beast::tcp_stream stream_;
+        http::response<http::empty_body> res_;
+        http::response_serializer<http::empty_body> sr_{res_};
+        std::deque<std::shared_ptr<const std::string>> queue_;
+        std::uint64_t last_version_ = 0;
+        char probe_[64];
+
+    public:
+        explicit sse_session(tcp::socket &&socket) : stream_(std::move(socket)) {}
+
+        ~sse_session()
+        {
+            unsubscribe(this);
+        }
+
+        void run(const http::request<http::string_body> &req)
+        {
+            // a reconnecting EventSource that is already current doesn't need the snapshot again; an id
+            // from before a restart names nothing here, so that client starts over from a snapshot
+            if (!parse_version_tag(to_std(req["Last-Event-ID"]), last_version_))
+                last_version_ = 0;
+            res_.version(req.version());
+            res_.result(http::status::ok);
+            res_.set(http::field::server, "Beast");
+            res_.set("Access-Control-Allow-Origin", "*");
+            res_.set(http::field::content_type, "text/event-stream");
+            res_.set(http::field::cache_control, "no-cache");
+            // the stream is delimited by connection close, no length or chunking
+            res_.keep_alive(false);
+            stream_.expires_after(std::chrono::seconds(30));
+            http::async_write_header(stream_, sr_, beast::bind_front_handler(&sse_session::on_header, shared_from_this()));
+        }
+
+        void push(const std::shared_ptr<const stocks_snapshot> &snap) override
+        {
+            net::post(stream_.get_executor(), beast::bind_front_handler(&sse_session::on_push, shared_from_this(), snap));
+        }
+
+    private:
+        void on_header(beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                return fail(ec, "sse header");
+            stream_.expires_never();
+            if (auto snap = subscribe(shared_from_this()))
+            {
+                if (last_version_ > snap->version)
+                    last_version_ = 0; // not a version this process has published
+                on_push(snap);
+            }
+            do_probe();
+        }
+
+        // EventSource never sends anything after the request, so a completed read means the peer left
+        void do_probe()
+        {
+            stream_.socket().async_read_some(net::buffer(probe_), beast::bind_front_handler(&sse_session::on_probe, shared_from_this()));
+        }
+
+        void on_probe(beast::error_code ec, std::size_t)
+        {
+            if (!ec)
+                return do_probe();
+            beast::error_code ignored;
+            stream_.socket().close(ignored);
+        }
+
+        void on_push(std::shared_ptr<const stocks_snapshot> snap)
+        {
+            if (snap->version <= last_version_)
+                return;
+            if (queue_.size() >= max_pending_frames)
+            {
+                std::cerr << "[sse] dropping slow subscriber" << std::endl;
+                beast::error_code ignored;
+                stream_.socket().close(ignored);
+                return;
+            }
+            const stocks_delta *delta = last_version_ ? snap->delta_from(last_version_) : nullptr;
+            last_version_ = snap->version;
+            queue_.push_back(std::shared_ptr<const std::string>(snap, delta ? &delta->sse_event : &snap->sse_event));
+            if (queue_.size() == 1)
+                do_write();
+        }
+
+        void do_write()
+        {
+            // a reader that can't drain one frame in 30s is as good as gone
+            stream_.expires_after(std::chrono::seconds(30));
+            net::async_write(stream_, net::buffer(*queue_.front()), beast::bind_front_handler(&sse_session::on_write, shared_from_this()));
+        }
+
+        void on_write(beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                return fail(ec, "sse write");
+            stream_.expires_never();
+            queue_.pop_front();
+            if (!queue_.empty())
+                do_write();
+        }
+    };
+
+    class http_session : public std::enable_shared_from_this<http_session>
+    {
+        // Max requests read ahead of their responses on one connection (pipelining depth).
+        static constexpr std::size_t queue_limit = 8;
+
+        struct work
+        {
+            virtual ~work() = default;
+            virtual void operator()() = 0;
+        };
+
+        // Copyable handle given to handle_request; parks the response in its request's slot on the strand.
+        struct send_lambda
+        {
+            std::shared_ptr<http_session> self;
+            std::uint64_t seq;
+            bool keep_alive;
+
+            template <bool isRequest, class Body, class Fields>
+            void operator()(http::message<isRequest, Body, Fields> &&msg) const
+            {
+                struct work_impl : work
+                {
+                    http_session &session;
+                    http::message<isRequest, Body, Fields> msg;
+
+                    work_impl(http_session &s, http::message<isRequest, Body, Fields> &&m) : session(s), msg(std::move(m)) {}
+
+                    void operator()() override
+                    {
+                        http::async_write(session.stream_, msg,
+                                          beast::bind_front_handler(&http_session::on_write, session.shared_from_this(), msg.need_eof()));
+                    }
+                };
+                msg.keep_alive(keep_alive);
+                std::unique_ptr<work> w = std::make_unique<work_impl>(*self, std::move(msg));
+                net::post(self->stream_.get_executor(), [self = self, seq = seq, w = std::move(w)]() mutable
+                          { self->on_response(seq, std::move(w)); });
+            }
+
+            // Answers with a chunked response instead; the body is fed through the returned sink.
+            std::shared_ptr<chunk_sink> chunked(http::response<http::empty_body> &&header) const
+            {
+                header.keep_alive(keep_alive);
+                auto sink = std::make_shared<chunked_sink>(self, std::move(header));
+                std::unique_ptr<work> w = std::make_unique<chunked_work>(*self, sink);
+                net::post(self->stream_.get_executor(), [self = self, seq = seq, w = std::move(w)]() mutable
+                          { self->on_response(seq, std::move(w)); });
+                return sink;
+            }
+        };
+
+        // chunk_sink handed out by send_lambda::chunked. Producer calls post one step at a time to the
+        // strand; steps are written once the response reaches the head of the queue.
+        class chunked_sink : public chunk_sink, public std::enable_shared_from_this<chunked_sink>
+        {
+            std::weak_ptr<http_session> session_;
+            http::response<http::empty_body> header_;
+            http::response_serializer<http::empty_body> sr_{header_};
+
+            // strand only
+            bool started_ = false; // reached the head of the queue
+            bool busy_ = false;    // a write is in flight
+            bool header_done_ = false;
+            bool failed_ = false;
+            bool abort_ = false;
+            std::string chunk_; // pending step, valid while done_ is set
+            std::string size_line_;
+            bool last_ = false;
+            std::shared_ptr<std::promise<bool>> done_;
+
+        public:
+            chunked_sink(const std::shared_ptr<http_session> &session, http::response<http::empty_body> &&header)
+                : session_(session), header_(std::move(header))
+            {
+                header_.chunked(true);
+            }
+
+            bool write(std::string chunk) override
+            {
+                if (chunk.empty())
+                    return true; // an empty chunk would end the body
+                return submit(std::move(chunk), false);
+            }
+
+            bool finish(http::fields trailers) override
+            {
+                std::string last = "0\r\n";
+                for (const auto &f : trailers)
+                {
+                    last.append(f.name_string().data(), f.name_string().size());
+                    last += ": ";
+                    last.append(f.value().data(), f.value().size());
+                    last += "\r\n";
+                }
+                last += "\r\n";
+                return submit(std::move(last), true);
+            }
+
+            void abort() override
+            {
+                auto session = session_.lock();
+                if (!session)
+                    return;
+                net::post(session->stream_.get_executor(), [self = shared_from_this(), session]
+                          {
+                    self->abort_ = true;
+                    self->pump(*session); });
+            }
+
+            // Strand side: the response reached the head of the queue.
+            void start(http_session &s)
+            {
+                started_ = true;
+                pump(s);
+            }
+
+            // Strand side: the session dropped this response without writing it.
+            void abandon()
+            {
+                failed_ = true;
+                if (done_)
+                    std::exchange(done_, nullptr)->set_value(false);
+            }
+
+        private:
+            bool submit(std::string data, bool last)
+            {
+                auto session = session_.lock();
+                if (!session)
+                    return false;
+                auto done = std::make_shared<std::promise<bool>>();
+                auto written = done->get_future();
+                net::post(session->stream_.get_executor(), [self = shared_from_this(), session, data = std::move(data), last, done]() mutable
+                          {
+                    if (self->failed_)
+                        return done->set_value(false);
+                    self->chunk_ = std::move(data);
+                    self->last_ = last;
+                    self->done_ = std::move(done);
+                    self->pump(*session); });
+                session.reset();
+                try
+                {
+                    return written.get();
+                }
+                catch (const std::future_error &)
+                {
+                    return false; // the io_context went away with the step still queued
+                }
+            }
+
+            void pump(http_session &s)
+            {
+                if (!started_ || busy_ || failed_)
+                    return;
+                if (abort_)
+                {
+                    failed_ = true;
+                    if (done_)
+                        std::exchange(done_, nullptr)->set_value(false);
+                    return s.on_write(true, {}, 0);
+                }
+                if (header_done_ && !done_)
+                    return; // waiting for the producer
+                busy_ = true;
+                s.stream_.expires_after(std::chrono::seconds(30));
+                if (!header_done_)
+                {
+                    http::async_write_header(s.stream_, sr_, [self = shared_from_this(), sp = s.shared_from_this()](beast::error_code ec, std::size_t n)
+                                             { self->on_step(*sp, false, ec, n); });
+                    return;
+                }
+                if (last_)
+                {
+                    net::async_write(s.stream_, net::buffer(chunk_), [self = shared_from_this(), sp = s.shared_from_this()](beast::error_code ec, std::size_t n)
+                                     { self->on_step(*sp, true, ec, n); });
+                    return;
+                }
+                char hex[24];
+                auto end = std::to_chars(hex, hex + sizeof(hex), chunk_.size(), 16).ptr;
+                size_line_.assign(hex, end);
+                size_line_ += "\r\n";
+                std::array<net::const_buffer, 3> buffers{net::buffer(size_line_), net::buffer(chunk_), net::buffer("\r\n", 2)};
+                net::async_write(s.stream_, buffers, [self = shared_from_this(), sp = s.shared_from_this()](beast::error_code ec, std::size_t n)
+                                 { self->on_step(*sp, false, ec, n); });
+            }
+
+            void on_step(http_session &s, bool last, beast::error_code ec, std::size_t n)
+            {
+                busy_ = false;
+                bool was_header = !header_done_;
+                header_done_ = true;
+                if (ec)
+                {
+                    failed_ = true;
+                    if (done_)
+                        std::exchange(done_, nullptr)->set_value(false);
+                    return s.on_write(true, ec, n);
+                }
+                if (!was_header)
+                    std::exchange(done_, nullptr)->set_value(true);
+                if (last)
+                    return s.on_write(header_.need_eof(), ec, n); // pops this response off the queue
+                pump(s);
+            }
+        };
+
+        struct chunked_work : work
+        {
+            http_session &session;
+            std::shared_ptr<chunked_sink> sink;
+
+            chunked_work(http_session &s, std::shared_ptr<chunked_sink> k) : session(s), sink(std::move(k)) {}
+            ~chunked_work() override
+            {
+                sink->abandon();
+            }
+
+            void operator()() override
+            {
+                sink->start(session);
+            }
+        };
+
+        beast::tcp_stream stream_;
+        beast::flat_buffer buffer_;
+        http::request<http::string_body> req_;
+        // One slot per outstanding request in arrival order; empty until its handler responds.
+        std::deque<std::unique_ptr<work>> queue_;
+        std::uint64_t head_seq_ = 0;
+        bool reading_ = false;
+        bool writing_ = false;
+        bool read_eof_ = false;
+        bool write_failed_ = false;
+        // A request that takes_over() read while earlier responses were still queued; handed off
+        // once the last of them is written.
+        std::optional<http::request<http::string_body>> handoff_;
+
+    public:
+        explicit http_session(tcp::socket &&socket) : stream_(std::move(socket)) {}
+
+        void run()
+        {
+            net::dispatch(stream_.get_executor(), beast::bind_front_handler(&http_session::do_read, shared_from_this()));
+        }
+
+    private:
+        void do_read()
+        {
+            req_ = {};
+            reading_ = true;
+            stream_.expires_after(std::chrono::seconds(30));
+            http::async_read(stream_, buffer_, req_, beast::bind_front_handler(&http_session::on_read, shared_from_this()));
+        }
+
+        void on_read(beast::error_code ec, std::size_t)
+        {
+            reading_ = false;
+            if (ec == http::error::end_of_stream)
+            {
+                read_eof_ = true;
+                if (queue_.empty())
+                    do_close();
+                return;
+            }
+            if (ec)
+                return fail(ec, "read");
+            if (takes_over(req_))
+            {
+                // hand the socket over once nothing is left to write on it; until then read no further
+                if (queue_.empty())
+                    hand_off(std::move(req_));
+                else
+                    handoff_ = std::move(req_);
+                return;
+            }
+            bool keep_alive = req_.keep_alive();
+            std::uint64_t seq = head_seq_ + queue_.size();
+            queue_.emplace_back();
+            handle_request(std::move(req_), send_lambda{shared_from_this(), seq, keep_alive});
+            // keep reading pipelined requests while earlier responses are still in flight
+            if (keep_alive && queue_.size() < queue_limit)
+                do_read();
+        }
+
+        // /ws/stocks upgrades and GET /stocks/stream leave this session for one of their own.
+        static bool takes_over(const http::request<http::string_body> &req)
+        {
+            auto path = split_target(req.target()).first;
+            return (websocket::is_upgrade(req) && path == "/ws/stocks") ||
+                   (req.method() == http::verb::get && path == "/stocks/stream");
+        }
+
+        void hand_off(http::request<http::string_body> req)
+        {
+            if (websocket::is_upgrade(req))
+                std::make_shared<websocket_session>(stream_.release_socket())->run(std::move(req));
+            else
+                std::make_shared<sse_session>(stream_.release_socket())->run(req);
+        }
+
+        void on_response(std::uint64_t seq, std::unique_ptr<work> w)
+        {
+            if (write_failed_)
+                return; // dropping w releases a chunked producer waiting on it
+            queue_[seq - head_seq_] = std::move(w);
+            if (seq == head_seq_ && !writing_)
+                do_write();
+        }
+
+        void do_write()
+        {
+            writing_ = true;
+            stream_.expires_after(std::chrono::seconds(30));
+            (*queue_.front())();
+        }
+
+        void on_write(bool close, beast::error_code ec, std::size_t)
+        {
+            writing_ = false;
+            if (ec)
+            {
+                // nothing more will be written here; release any chunked producers still queued
+                write_failed_ = true;
+                for (auto &w : queue_)
+                    w.reset();
+                return fail(ec, "write");
+            }
+            if (close)
+                return do_close();
+            queue_.pop_front();
+            ++head_seq_;
+            if (queue_.empty() && handoff_)
+                return hand_off(*std::exchange(handoff_, std::nullopt));
+            if (!queue_.empty() && queue_.front())
+                do_write();
+            else if (queue_.empty() && read_eof_)
+                return do_close();
+            if (!reading_ && !read_eof_ && !handoff_ && queue_.size() < queue_limit)
+                do_read();
+        }
+
+        void do_close()
+        {
+            beast::error_code ec;
+            stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+        }
+    };
+
+    class listener : public std::enable_shared_from_this<listener>
+    {
+        net::io_context &ioc_;
+        tcp::acceptor acceptor_;
+
+    public:
+        listener(net::io_context &ioc, tcp::endpoint endpoint) : ioc_(ioc), acceptor_(net::make_strand(ioc))
+        {
+            acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(net::socket_base::reuse_address(true));
+            acceptor_.bind(endpoint);
+            acceptor_.listen(net::socket_base::max_listen_connections);
+        }
+
+        void run()
+        {
+            do_accept();
+        }
+
+    private:
+        void do_accept()
+        {
+            // each connection gets its own strand so handlers never run concurrently on one socket
+            acceptor_.async_accept(net::make_strand(ioc_), beast::bind_front_handler(&listener::on_accept, shared_from_this()));
+        }
+
+        void on_accept(beast::error_code ec, tcp::socket socket)
+        {
+            if (ec)
+                fail(ec, "accept");
+            else
+                std::make_shared<http_session>(std::move(socket))->run();
+            do_accept();
+        }
+    };
+}
+
+void run_http_server(unsigned short port)
+{
+    if (const char *envR = std::getenv("STOCKS_REFRESH_SECONDS"))
+    {
+        try
+        {
+            refresh_seconds = std::max(5, std::stoi(envR));
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envS = std::getenv("STOCKS_SYMBOLS"))
+    {
+        if (std::string(envS).size() > 0)
+            symbols_cfg = envS;
+    }
+    if (const char *envP = std::getenv("STOCKS_PROVIDER"))
+    {
+        std::string val = to_upper(envP);
+        if (val == "STOOQ" || val == "YAHOO" || val == "TRADING212")
+            stocks_provider = val;
+        else
+            std::cerr << "[stocks] unknown provider '" << val << "' defaulting to " << stocks_provider << "\n";
+    }
+    if (const char *envU = std::getenv("SCRAPER_URL"))
+    {
+        scraper_url = envU;
+    }
+    if (const char *envC = std::getenv("STOOQ_FALLBACK_CONCURRENCY"))
+    {
+        try
+        {
+            stooq_fallback_concurrency = std::max(1, std::stoi(envC));
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envD = std::getenv("STOOQ_FALLBACK_DEADLINE_SECONDS"))
+    {
+        try
+        {
+            stooq_fallback_deadline_seconds = std::max(1, std::stoi(envD));
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envL = std::getenv("STOOQ_MAX_URL_LENGTH"))
+    {
+        try
+        {
+            stooq_max_target_length = std::max(64, std::stoi(envL));
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envBp = std::getenv("BOOK_PRICE_DECIMALS"))
+    {
+        try
+        {
+            book_instrument.price_decimals = std::clamp(std::stoi(envBp), 0, max_decimals);
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envBa = std::getenv("BOOK_AMOUNT_DECIMALS"))
+    {
+        try
+        {
+            book_instrument.amount_decimals = std::clamp(std::stoi(envBa), 0, max_decimals);
+        }
+        catch (...)
+        {
+        }
+    }
+    if (const char *envPg = std::getenv("PG_CONNINFO"))
+        pg_conninfo = envPg;
+    if (const char *envPs = std::getenv("PG_POOL_SIZE"))
+    {
+        try
+        {
+            pg_pool_size = std::max(1, std::stoi(envPs));
+        }
+        catch (...)
+        {
+        }
+    }
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (const char *envT = std::getenv("HTTP_THREADS"))
+    {
+        try
+        {
+            threads = std::max(1, std::stoi(envT));
+        }
+        catch (...)
+        {
+        }
+    }
+    std::thread bg(stocks_background_loop);
+    bg.detach();
+    std::thread book(engine_loop);
+    std::thread persist(persist_loop);
+    book.detach();
+    persist.detach();
+    try
+    {
+        net::io_context ioc{threads};
+        std::make_shared<listener>(ioc, tcp::endpoint{tcp::v4(), port})->run();
+        std::cout << "HTTP server listening on port " << port << " (stocks refresh=" << refresh_seconds << "s, threads=" << threads << ")" << std::endl;
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (int i = 1; i < threads; ++i)
+            workers.emplace_back([&ioc]
+                                 { ioc.run(); });
+        ioc.run();
+        for (auto &w : workers)
+            w.join();
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Content codings the server can produce for precompressed payloads.
+enum class content_coding
+{
+    identity,
+    gzip,
+    br,
+    none // the client refuses every coding the caller has, identity included
+};
+
+// Compresses `data` as a gzip member (RFC 1952). Throws std::runtime_error on zlib failure.
+std::string gzip_compress(std::string_view data);
+
+// Compresses `data` as a brotli stream (RFC 7932). Throws std::runtime_error on encoder failure.
+std::string brotli_compress(std::string_view data);
+
+// Picks the best coding a client accepts from an Accept-Encoding header value, honoring q-values,
+// among br and gzip when the caller has them (identity always is). Ties go to br, then gzip, then
+// identity. none when identity is refused (identity;q=0, or *;q=0 without listing it) and no
+// coding the caller has is accepted; the caller may then answer 406.
+content_coding negotiate_coding(std::string_view accept_encoding, bool have_br = true, bool have_gzip = true);
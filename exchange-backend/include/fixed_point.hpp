@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A whole number of an instrument's smallest step, e.g. cents. The tag keeps prices and amounts
+// from being mixed up; how many decimals one step is lives with the instrument, not the type.
+// Comparisons and sums are plain integer ops, so nothing drifts the way repeated double
+// arithmetic does, and a value can be hashed or used as an index directly.
+template <class Tag>
+struct fixed_units
+{
+    std::int64_t units = 0;
+
+    constexpr fixed_units() = default;
+    constexpr explicit fixed_units(std::int64_t u) : units(u) {}
+
+    friend constexpr bool operator==(fixed_units a, fixed_units b)
+    {
+        return a.units == b.units;
+    }
+
+    friend constexpr bool operator!=(fixed_units a, fixed_units b)
+    {
+        return a.units != b.units;
+    }
+
+    friend constexpr bool operator<(fixed_units a, fixed_units b)
+    {
+        return a.units < b.units;
+    }
+
+    friend constexpr bool operator<=(fixed_units a, fixed_units b)
+    {
+        return a.units <= b.units;
+    }
+
+    friend constexpr bool operator>(fixed_units a, fixed_units b)
+    {
+        return a.units > b.units;
+    }
+
+    friend constexpr bool operator>=(fixed_units a, fixed_units b)
+    {
+        return a.units >= b.units;
+    }
+
+    friend constexpr fixed_units operator+(fixed_units a, fixed_units b)
+    {
+        return fixed_units(a.units + b.units);
+    }
+
+    friend constexpr fixed_units operator-(fixed_units a, fixed_units b)
+    {
+        return fixed_units(a.units - b.units);
+    }
+
+    constexpr fixed_units &operator+=(fixed_units b)
+    {
+        units += b.units;
+        return *this;
+    }
+
+    constexpr fixed_units &operator-=(fixed_units b)
+    {
+        units -= b.units;
+        return *this;
+    }
+};
+
+struct price_tag;
+struct qty_tag;
+
+using price_ticks = fixed_units<price_tag>; // a price in ticks
+using qty_lots = fixed_units<qty_tag>;      // an amount in lots
+
+namespace std
+{
+    template <class Tag>
+    struct hash<fixed_units<Tag>>
+    {
+        std::size_t operator()(fixed_units<Tag> v) const noexcept
+        {
+            return std::hash<std::int64_t>{}(v.units);
+        }
+    };
+}
+
+// Longest supported scale; keeps 10^decimals and values up to ~9e10 whole units within int64.
+constexpr int max_decimals = 8;
+
+// Exact decimal text ("101.50", "-3", "0.0001") to units of 10^-decimals. Digits past `decimals`
+// must be zeros. nullopt for anything else, including exponents and out-of-range values.
+std::optional<std::int64_t> parse_decimal(std::string_view text, int decimals);
+
+// The nearest whole number of units to `v`, if `v` is within rounding noise of one; nullopt when
+// it has more precision than `decimals` allows, or isn't finite.
+std::optional<std::int64_t> decimal_from_double(double v, int decimals);
+
+// Writes `units` as the shortest decimal text that parses back to it ("101.5", "3") and returns
+// the end. `buf` needs room for 32 chars; `decimals` must be 0..max_decimals.
+char *format_decimal(char *buf, std::int64_t units, int decimals);
+std::string format_decimal(std::int64_t units, int decimals);
+
+double decimal_to_double(std::int64_t units, int decimals);
+
+// How one instrument's prices and amounts map to ticks and lots: a price tick is
+// 10^-price_decimals and an amount lot is 10^-amount_decimals.
+struct instrument
+{
+    int price_decimals = 2;
+    int amount_decimals = 4;
+
+    std::optional<price_ticks> parse_price(std::string_view text) const
+    {
+        auto u = parse_decimal(text, price_decimals);
+        return u ? std::optional<price_ticks>(price_ticks(*u)) : std::nullopt;
+    }
+
+    std::optional<qty_lots> parse_amount(std::string_view text) const
+    {
+        auto u = parse_decimal(text, amount_decimals);
+        return u ? std::optional<qty_lots>(qty_lots(*u)) : std::nullopt;
+    }
+
+    std::optional<price_ticks> price_from(double v) const
+    {
+        auto u = decimal_from_double(v, price_decimals);
+        return u ? std::optional<price_ticks>(price_ticks(*u)) : std::nullopt;
+    }
+
+    std::optional<qty_lots> amount_from(double v) const
+    {
+        auto u = decimal_from_double(v, amount_decimals);
+        return u ? std::optional<qty_lots>(qty_lots(*u)) : std::nullopt;
+    }
+
+    std::string format(price_ticks p) const
+    {
+        return format_decimal(p.units, price_decimals);
+    }
+
+    std::string format(qty_lots q) const
+    {
+        return format_decimal(q.units, amount_decimals);
+    }
+};
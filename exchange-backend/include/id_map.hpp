@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Int id -> T* in one flat array: open addressing with linear probing and backward-shift
+// deletion, so there are no per-entry nodes and no tombstones to slow lookups after heavy
+// erase traffic. It allocates only when it doubles, at half full. Null values can't be stored.
+// Not thread-safe.
+template <class T>
+class id_map
+{
+public:
+    id_map()
+    {
+        rehash(1024);
+    }
+
+    T *find(int key) const
+    {
+        for (std::size_t i = home(key);; i = (i + 1) & mask_)
+        {
+            const entry &e = slots_[i];
+            if (!e.value)
+                return nullptr;
+            if (e.key == key)
+                return e.value;
+        }
+    }
+
+    // False (and the map unchanged) if `key` is already present.
+    bool insert(int key, T *value)
+    {
+        if ((size_ + 1) * 2 > slots_.size())
+            rehash(slots_.size() * 2);
+        std::size_t i = home(key);
+        for (; slots_[i].value; i = (i + 1) & mask_)
+            if (slots_[i].key == key)
+                return false;
+        slots_[i] = {key, value};
+        ++size_;
+        return true;
+    }
+
+    // Removes `key` and returns its value; nullptr when it isn't present.
+    T *erase(int key)
+    {
+        std::size_t i = home(key);
+        for (; slots_[i].key != key; i = (i + 1) & mask_)
+            if (!slots_[i].value)
+                return nullptr;
+        if (!slots_[i].value)
+            return nullptr;
+        T *removed = slots_[i].value;
+        // pull later entries of the probe run back into the hole so every key stays reachable
+        // from its home slot without passing an empty one
+        for (std::size_t j = (i + 1) & mask_; slots_[j].value; j = (j + 1) & mask_)
+        {
+            std::size_t h = home(slots_[j].key);
+            // move j into i unless its home lies cyclically in (i, j]
+            bool stays = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+            if (!stays)
+            {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i] = {};
+        --size_;
+        return removed;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    // Grows so that `n` entries fit without another rehash.
+    void reserve(std::size_t n)
+    {
+        std::size_t want = slots_.size();
+        while (n * 2 > want)
+            want *= 2;
+        if (want != slots_.size())
+            rehash(want);
+    }
+
+private:
+    struct entry
+    {
+        int key = 0;
+        T *value = nullptr;
+    };
+
+    // Fibonacci hashing: ids are mostly consecutive, and the multiply spreads them over the
+    // top bits so runs don't pile up in neighbouring slots.
+    std::size_t home(int key) const
+    {
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(static_cast<std::uint32_t>(key)) * 0x9e3779b97f4a7c15ull) >> shift_);
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<entry> old = std::move(slots_);
+        slots_.assign(capacity, entry{});
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (std::size_t c = capacity; c > 1; c >>= 1)
+            --shift_;
+        size_ = 0;
+        for (const entry &e : old)
+            if (e.value)
+            {
+                std::size_t i = home(e.key);
+                while (slots_[i].value)
+                    i = (i + 1) & mask_;
+                slots_[i] = e;
+                ++size_;
+            }
+    }
+
+    std::vector<entry> slots_;
+    std::size_t mask_ = 0;
+    unsigned shift_ = 64;
+    std::size_t size_ = 0;
+};
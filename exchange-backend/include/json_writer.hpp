@@ -0,0 +1,65 @@
+#pragma once
+
+#include "fixed_point.hpp"
+#include "order_book.hpp"
+#include "orders.hpp"
+#include "quote_table.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Appends JSON tokens to a buffer that keeps its capacity across clear(), so a long-lived
+// writer stops allocating once it has seen its largest document.
+class json_writer
+{
+public:
+    std::string out;
+
+    void clear()
+    {
+        out.clear();
+    }
+
+    std::string_view view() const
+    {
+        return out;
+    }
+
+    // Appends `s` verbatim; used for precomputed key fragments and punctuation.
+    void raw(std::string_view s)
+    {
+        out.append(s);
+    }
+
+    void raw(char c)
+    {
+        out.push_back(c);
+    }
+
+    // Shortest representation that round-trips. Like dump(), integral values keep a trailing ".0"
+    // and NaN/inf become null. The digits can be shorter than dump()'s, which isn't always shortest,
+    // and very small values may use an exponent where dump() doesn't; both parse to the same double.
+    void number(double v);
+    void number(std::int64_t v);
+
+    // `units` of 10^-decimals written exactly, e.g. 10150 at 2 decimals as 101.5. Whole values
+    // keep a trailing ".0" like number(double), so output is unchanged for clients.
+    void decimal(std::int64_t units, int decimals);
+
+    // Quoted and escaped. Bytes >= 0x80 are passed through as-is.
+    void string(std::string_view s);
+};
+
+// The /stocks row schema, keys in the same order dump() emits them.
+void write_quote(json_writer &w, const quote_table &t, std::size_t row);
+void write_quotes(json_writer &w, const quote_table &t);
+
+// The /orders row schema, keys in the same order dump() emits them.
+void write_order(json_writer &w, const instrument &inst, const order_record &o);
+void write_orders(json_writer &w, const instrument &inst, const std::vector<order_record> &orders);
+
+// The /orderbook schema: {"asks":[{"amount":..,"orders":..,"price":..},...],"bids":[...]},
+// best level first and at most `depth` levels a side.
+void write_book(json_writer &w, const instrument &inst, const std::vector<level_view> &bids, const std::vector<level_view> &asks,
+                std::size_t depth = SIZE_MAX);
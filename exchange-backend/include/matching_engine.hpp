@@ -0,0 +1,103 @@
+#pragma once
+
+#include "order_book.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+enum class order_type : std::uint8_t
+{
+    limit,
+    market
+};
+
+// Values written to orders.status.
+enum class order_status : std::uint8_t
+{
+    open,      // resting, nothing traded yet
+    partial,   // resting, partly traded
+    filled,    // fully traded
+    cancelled, // cancelled, or a market order's untraded rest
+    rejected   // never entered the book
+};
+
+std::string_view to_string(order_status s);
+
+struct order_request
+{
+    int id = 0;
+    int user_id = 0;
+    order_side side = order_side::buy;
+    order_type type = order_type::limit;
+    price_ticks price; // ignored for market orders
+    qty_lots amount;
+};
+
+// One trade, at the resting (maker) order's price.
+struct fill
+{
+    int taker_id = 0;
+    int taker_user_id = 0;
+    int maker_id = 0;
+    int maker_user_id = 0;
+    price_ticks price;
+    qty_lots amount;
+};
+
+// New status of an order touched by a command, and what is left of it.
+struct order_update
+{
+    int id = 0;
+    order_status status = order_status::open;
+    qty_lots remaining;
+};
+
+// Everything one command did, in the order it happened. Makers' updates come before the taker's.
+struct match_result
+{
+    std::uint64_t sequence = 0; // position of the command in the engine's input, from 1
+    bool accepted = false;
+    std::vector<fill> fills;
+    std::vector<order_update> updates;
+};
+
+// Price-time priority matching for one instrument. Single-threaded and deterministic: the same
+// commands in the same order always give the same fills, so the engine can be replayed.
+class matching_engine
+{
+public:
+    // Crosses `o` against the resting orders it reaches. A limit order's remainder rests in the
+    // book if it can (see order_book::can_rest) and is cancelled otherwise; a market order's
+    // remainder is cancelled. Rejected (and the book untouched) when the amount isn't positive, a
+    // limit price isn't positive, the id is already resting, or a limit order that can't rest
+    // trades nothing.
+    // The returned result is reused by the next command.
+    const match_result &submit(const order_request &o);
+
+    // Cancels a resting order; rejected when no such order rests.
+    const match_result &cancel(int id);
+
+    // Puts an already-accepted order back into the book without matching, e.g. when reloading
+    // open orders at startup. Does not take a sequence number.
+    bool restore(const book_order &o)
+    {
+        return book_.add(o);
+    }
+
+    const order_book &book() const
+    {
+        return book_;
+    }
+
+    std::uint64_t sequence() const
+    {
+        return sequence_;
+    }
+
+private:
+    match_result &begin();
+
+    order_book book_;
+    std::uint64_t sequence_ = 0;
+    match_result result_;
+};
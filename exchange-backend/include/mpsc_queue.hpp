@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue for many producers and one consumer (Dmitry Vyukov's bounded queue with
+// the consumer side simplified). Each cell carries a sequence number that says whose turn it is,
+// so producers only contend on one CAS of the tail and never wait on each other or the consumer.
+template <class T>
+class mpsc_queue
+{
+public:
+    // `capacity` is rounded up to a power of two.
+    explicit mpsc_queue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        cells_ = std::make_unique<cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    mpsc_queue(const mpsc_queue &) = delete;
+    mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+    // Any thread. Moves from `v` only on success; false when the queue is full.
+    bool try_push(T &&v)
+    {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        cell *c;
+        for (;;)
+        {
+            c = &cells_[pos & mask_];
+            std::size_t seq = c->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // the consumer hasn't freed this cell yet
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        c->value = std::move(v);
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. False when nothing is ready.
+    bool try_pop(T &out)
+    {
+        cell &c = cells_[head_ & mask_];
+        if (c.seq.load(std::memory_order_acquire) != head_ + 1)
+            return false;
+        out = std::move(c.value);
+        c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    // Consumer thread only.
+    bool empty() const
+    {
+        return cells_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+private:
+    struct cell
+    {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<cell[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_{0}; // next position producers claim
+    alignas(64) std::size_t head_ = 0;             // next position the consumer reads
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which of n slots are in use: a bit per slot, plus a bit per 64-slot word saying whether that word
+// has any set. Finding the next used slot above or below an index skips empty stretches 4096
+// slots at a time, so a sparse array can be walked in time proportional to what is in it rather
+// than to its length.
+// Not thread-safe.
+class occupancy_bitmap
+{
+public:
+    static constexpr std::size_t none = SIZE_MAX;
+
+    // Sizes the bitmap for `n` slots, all clear.
+    void assign(std::size_t n)
+    {
+        words_.assign((n + 63) / 64, 0);
+        summary_.assign((words_.size() + 63) / 64, 0);
+    }
+
+    void set(std::size_t i)
+    {
+        words_[i / 64] |= bit(i % 64);
+        summary_[i / 4096] |= bit(i / 64 % 64);
+    }
+
+    void reset(std::size_t i)
+    {
+        if ((words_[i / 64] &= ~bit(i % 64)) == 0)
+            summary_[i / 4096] &= ~bit(i / 64 % 64);
+    }
+
+    // Lowest set slot above `i`, or none.
+    std::size_t next_after(std::size_t i) const
+    {
+        std::size_t j = i + 1;
+        std::size_t w = j / 64;
+        if (w >= words_.size())
+            return none;
+        if (std::uint64_t m = words_[w] & (~std::uint64_t{0} << (j % 64)))
+            return w * 64 + lowest(m);
+        if (++w >= words_.size())
+            return none;
+        std::size_t s = w / 64;
+        std::uint64_t m = summary_[s] & (~std::uint64_t{0} << (w % 64));
+        while (!m)
+        {
+            if (++s >= summary_.size())
+                return none;
+            m = summary_[s];
+        }
+        w = s * 64 + lowest(m);
+        return w * 64 + lowest(words_[w]);
+    }
+
+    // Highest set slot below `i`, or none.
+    std::size_t prev_before(std::size_t i) const
+    {
+        if (i == 0)
+            return none;
+        std::size_t j = i - 1;
+        std::size_t w = j / 64;
+        if (std::uint64_t m = words_[w] & (~std::uint64_t{0} >> (63 - j % 64)))
+            return w * 64 + highest(m);
+        if (w-- == 0)
+            return none;
+        std::size_t s = w / 64;
+        std::uint64_t m = summary_[s] & (~std::uint64_t{0} >> (63 - w % 64));
+        while (!m)
+        {
+            if (s-- == 0)
+                return none;
+            m = summary_[s];
+        }
+        w = s * 64 + highest(m);
+        return w * 64 + highest(words_[w]);
+    }
+
+private:
+    static std::uint64_t bit(std::size_t i)
+    {
+        return std::uint64_t{1} << i;
+    }
+
+    static std::size_t lowest(std::uint64_t m)
+    {
+        return static_cast<std::size_t>(__builtin_ctzll(m));
+    }
+
+    static std::size_t highest(std::uint64_t m)
+    {
+        return 63 - static_cast<std::size_t>(__builtin_clzll(m));
+    }
+
+    std::vector<std::uint64_t> words_;
+    std::vector<std::uint64_t> summary_;
+};
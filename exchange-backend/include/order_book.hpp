@@ -0,0 +1,220 @@
+#pragma once
+
+#include "fixed_point.hpp"
+#include "id_map.hpp"
+#include "occupancy_bitmap.hpp"
+#include "slab_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+enum class order_side : std::uint8_t
+{
+    buy,
+    sell
+};
+
+// "buy" / "sell" as stored in orders.side; nullopt for anything else.
+std::optional<order_side> parse_order_side(std::string_view s);
+std::string_view to_string(order_side s);
+
+// An order resting in the book. `amount` is what is left of it.
+struct book_order
+{
+    int id = 0;
+    int user_id = 0;
+    order_side side = order_side::buy;
+    price_ticks price;
+    qty_lots amount;
+};
+
+// One aggregated price level as /orderbook shows it.
+struct level_view
+{
+    price_ticks price;
+    qty_lots amount;
+    std::size_t orders = 0;
+};
+
+// Resting orders of one instrument. Each side keeps its levels in one flat array indexed by price
+// tick - base, so finding a level is an index, and the best level is tracked so the top of the book
+// is one load away. An occupancy bitmap over the array finds the next non-empty level when the best
+// one empties, and walks depth views, without visiting the empty ticks between resting prices
+// however far apart they are. A level keeps its orders in arrival order, as an intrusive list of
+// nodes from a slab pool, plus a running total, so aggregated depth needs no per-order walk. The
+// open-addressing id index points straight at each order's node, so cancels don't scan their level,
+// and once the pool and index have grown to the peak book size nothing allocates per order.
+// Not thread-safe: one thread owns the book and publishes views of it.
+class order_book
+{
+public:
+    // Widest span of ticks one side may cover, which bounds the ladder's memory; see can_rest().
+    static constexpr std::int64_t max_ladder_ticks = std::int64_t{1} << 20;
+
+    order_book();
+
+    // Whether an order at `price` could be queued on `side`: it is within max_ladder_ticks of
+    // what already rests there.
+    bool can_rest(order_side side, price_ticks price) const;
+
+    // Queues `o` behind the orders already at its price. False if its id is already resting,
+    // its amount isn't positive or !can_rest(o.side, o.price).
+    bool add(const book_order &o);
+
+    // Removes a resting order and returns it; nullopt when no order with that id rests here.
+    std::optional<book_order> cancel(int id);
+
+    bool contains(int id) const
+    {
+        return index_.find(id) != nullptr;
+    }
+
+    // Sizes the node pool and id index for `orders` resting orders up front.
+    void reserve(std::size_t orders)
+    {
+        nodes_.reserve(orders);
+        index_.reserve(orders);
+    }
+
+    // Crosses an incoming `taker` order for `amount` against the other side: best price first and
+    // oldest first within a price, never past `limit` (nullopt for no limit). on_fill(maker, traded)
+    // sees each maker before its amount is reduced; makers that are used up leave the book.
+    // Returns what is left of `amount`.
+    template <class OnFill>
+    qty_lots match(order_side taker, std::optional<price_ticks> limit, qty_lots amount, OnFill &&on_fill)
+    {
+        if (taker == order_side::buy)
+            return match_levels(asks_, limit ? limit->units : INT64_MAX, amount, on_fill);
+        return match_levels(bids_, limit ? limit->units : INT64_MIN, amount, on_fill);
+    }
+
+    // Up to `depth` levels of one side, best price first.
+    std::vector<level_view> bids(std::size_t depth = SIZE_MAX) const;
+    std::vector<level_view> asks(std::size_t depth = SIZE_MAX) const;
+
+    std::size_t size() const
+    {
+        return index_.size();
+    }
+
+private:
+    struct order_node
+    {
+        book_order order;
+        order_node *prev = nullptr;
+        order_node *next = nullptr;
+    };
+
+    // Orders at one price, oldest at head.
+    struct level
+    {
+        qty_lots amount;
+        std::size_t count = 0;
+        order_node *head = nullptr;
+        order_node *tail = nullptr;
+
+        bool empty() const
+        {
+            return head == nullptr;
+        }
+
+        void push_back(order_node *n)
+        {
+            n->prev = tail;
+            n->next = nullptr;
+            (tail ? tail->next : head) = n;
+            tail = n;
+            ++count;
+        }
+
+        void unlink(order_node *n)
+        {
+            (n->prev ? n->prev->next : head) = n->next;
+            (n->next ? n->next->prev : tail) = n->prev;
+            --count;
+        }
+    };
+
+    // One side of the book. levels[i] holds tick base + i; `best` and `worst` are the indexes of
+    // the outermost non-empty levels, best being the highest tick for bids and the lowest for asks.
+    struct ladder
+    {
+        static constexpr std::size_t none = SIZE_MAX;
+
+        bool bids = false;
+        std::int64_t base = 0;
+        std::vector<level> levels;
+        occupancy_bitmap occupied; // which levels are non-empty
+        std::size_t best = none;
+        std::size_t worst = none;
+        std::size_t used = 0; // non-empty levels
+
+        bool empty() const
+        {
+            return used == 0;
+        }
+
+        std::int64_t tick(std::size_t i) const
+        {
+            return base + static_cast<std::int64_t>(i);
+        }
+
+        bool better(std::size_t a, std::size_t b) const
+        {
+            return bids ? a > b : a < b;
+        }
+
+        // The next non-empty level after i, away from the touch; none past the worst.
+        std::size_t next_worse(std::size_t i) const
+        {
+            return bids ? occupied.prev_before(i) : occupied.next_after(i);
+        }
+
+        bool fits(std::int64_t t) const;
+        // The level for tick t, moving or growing the array if t is outside it. fits(t) must hold.
+        std::size_t slot(std::int64_t t);
+        void filled(std::size_t i);
+        void emptied(std::size_t i);
+    };
+
+    std::vector<level_view> view(const ladder &side, std::size_t depth) const;
+
+    template <class OnFill>
+    qty_lots match_levels(ladder &side, std::int64_t limit, qty_lots amount, OnFill &on_fill)
+    {
+        while (amount > qty_lots() && !side.empty())
+        {
+            std::int64_t t = side.tick(side.best);
+            if (side.bids ? t < limit : t > limit)
+                break;
+            level &l = side.levels[side.best];
+            while (amount > qty_lots() && !l.empty())
+            {
+                order_node *node = l.head;
+                book_order &maker = node->order;
+                qty_lots traded = std::min(amount, maker.amount);
+                on_fill(static_cast<const book_order &>(maker), traded);
+                amount -= traded;
+                maker.amount -= traded;
+                l.amount -= traded;
+                if (maker.amount == qty_lots())
+                {
+                    index_.erase(maker.id);
+                    l.unlink(node);
+                    nodes_.release(node);
+                }
+            }
+            if (l.empty())
+                side.emptied(side.best);
+        }
+        return amount;
+    }
+
+    ladder bids_;
+    ladder asks_;
+    slab_pool<order_node> nodes_;
+    id_map<order_node> index_;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "fixed_point.hpp"
+#include <string>
+
+// One row of the orders table, as /orders serves it. Price and amount are in the book
+// instrument's ticks and lots.
+struct order_record
+{
+    int id = 0;
+    int user_id = 0;
+    std::string side;
+    price_ticks price;
+    qty_lots amount;
+    std::string status;
+    std::string created_at;
+};
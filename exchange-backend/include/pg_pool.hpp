@@ -0,0 +1,74 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Fixed-size pool of long-lived Postgres connections. Connections are opened on first demand and
+// `prepare` runs once on each, so statements prepared there can be used on any leased connection.
+class pg_pool
+{
+public:
+    pg_pool(std::string conninfo, std::size_t size, std::function<void(pqxx::connection &)> prepare);
+
+    pg_pool(const pg_pool &) = delete;
+    pg_pool &operator=(const pg_pool &) = delete;
+
+    // Runs f(connection) on a pooled connection and returns what it returns. A connection that turns
+    // out to be broken (say Postgres restarted since it was last used) is dropped and f runs once
+    // more on a fresh one, so f must be safe to repeat. Throws std::runtime_error when no connection
+    // frees up within the acquire timeout.
+    template <class F>
+    auto run(F &&f) -> decltype(f(std::declval<pqxx::connection &>()))
+    {
+        for (int attempt = 0;; ++attempt)
+        {
+            lease l = acquire();
+            try
+            {
+                return f(*l.conn);
+            }
+            catch (const pqxx::broken_connection &)
+            {
+                l.conn.reset();
+                if (attempt > 0)
+                    throw;
+            }
+        }
+    }
+
+private:
+    // Gives the connection back on destruction; a null connection frees its slot instead.
+    struct lease
+    {
+        pg_pool *pool;
+        std::unique_ptr<pqxx::connection> conn;
+
+        lease(pg_pool *p, std::unique_ptr<pqxx::connection> c) : pool(p), conn(std::move(c)) {}
+        lease(const lease &) = delete;
+        lease &operator=(const lease &) = delete;
+        ~lease()
+        {
+            pool->release(std::move(conn));
+        }
+    };
+
+    lease acquire();
+    void release(std::unique_ptr<pqxx::connection> conn);
+
+    const std::string conninfo_;
+    const std::size_t size_;
+    const std::function<void(pqxx::connection &)> prepare_;
+    static constexpr std::chrono::seconds acquire_timeout{5};
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<pqxx::connection>> idle_;
+    std::size_t open_ = 0; // idle plus leased, plus any being opened
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One quote as a provider hands it over.
+struct quote
+{
+    std::string symbol;
+    std::string name;
+    double price = 0;
+    double change = 0;
+    double percent = 0;
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double volume = 0;
+};
+
+// Interned symbols. Ids are dense and never reused, and a table extended with
+// with_symbols keeps every existing id, so ids are comparable across refreshes.
+class symbol_table
+{
+public:
+    static constexpr std::uint32_t npos = UINT32_MAX;
+
+    std::uint32_t find(std::string_view symbol) const
+    {
+        auto it = ids_.find(std::string(symbol));
+        return it == ids_.end() ? npos : it->second;
+    }
+
+    const std::string &symbol(std::uint32_t id) const
+    {
+        return symbols_[id];
+    }
+
+    std::size_t size() const
+    {
+        return symbols_.size();
+    }
+
+    // `base` if it already knows every symbol in `quotes`, otherwise a copy of it with the rest appended.
+    // A null `base` counts as empty; the result is never null.
+    static std::shared_ptr<const symbol_table> with_symbols(const std::shared_ptr<const symbol_table> &base,
+                                                            const std::vector<quote> &quotes);
+
+private:
+    std::vector<std::string> symbols_;
+    std::unordered_map<std::string, std::uint32_t> ids_;
+};
+
+// Canonical quote cache: one row per symbol, each field in its own contiguous column.
+// Immutable once built; JSON is only produced from it when a snapshot is serialized.
+struct quote_table
+{
+    std::shared_ptr<const symbol_table> symbols;
+    std::vector<std::uint32_t> symbol_id;
+    std::vector<std::string> name;
+    std::vector<double> price;
+    std::vector<double> change;
+    std::vector<double> percent;
+    std::vector<double> open;
+    std::vector<double> high;
+    std::vector<double> low;
+    std::vector<double> volume;
+    std::vector<std::int32_t> row_of; // symbol id -> row, -1 when the symbol isn't in this table
+
+    std::size_t size() const
+    {
+        return symbol_id.size();
+    }
+
+    const std::string &symbol(std::size_t row) const
+    {
+        return symbols->symbol(symbol_id[row]);
+    }
+
+    // Row holding symbol `id`, or -1. Safe for ids interned after this table was built.
+    std::int32_t row(std::uint32_t id) const
+    {
+        return id < row_of.size() ? row_of[id] : -1;
+    }
+
+    std::int32_t find(std::string_view sym) const
+    {
+        return row(symbols->find(sym));
+    }
+
+    // Builds the table in `quotes` order; a repeated symbol keeps its first row.
+    static quote_table build(const std::vector<quote> &quotes, std::shared_ptr<const symbol_table> symbols);
+};
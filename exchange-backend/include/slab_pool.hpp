@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Objects of one type carved out of fixed-size slabs that are never handed back to the heap.
+// Released objects go on a free list and are reused first, so once the pool has grown to the
+// peak number of live objects, allocate() and release() never reach the allocator. Objects
+// never move, so pointers to them stay valid until they are released.
+// Not thread-safe.
+template <class T, std::size_t SlabSize = 4096>
+class slab_pool
+{
+public:
+    // A default-constructed-or-reused T; the caller overwrites what it needs.
+    T *allocate()
+    {
+        if (free_.empty())
+            grow();
+        T *p = free_.back();
+        free_.pop_back();
+        return p;
+    }
+
+    void release(T *p)
+    {
+        free_.push_back(p);
+    }
+
+    // Grows the pool to hold at least `n` objects without allocating again.
+    void reserve(std::size_t n)
+    {
+        while (slabs_.size() * SlabSize < n)
+            grow();
+    }
+
+    std::size_t capacity() const
+    {
+        return slabs_.size() * SlabSize;
+    }
+
+private:
+    void grow()
+    {
+        slabs_.push_back(std::make_unique<T[]>(SlabSize));
+        T *slab = slabs_.back().get();
+        free_.reserve(capacity());
+        // pushed in reverse so the slab is handed out front to back
+        for (std::size_t i = SlabSize; i-- > 0;)
+            free_.push_back(slab + i);
+    }
+
+    std::vector<std::unique_ptr<T[]>> slabs_;
+    std::vector<T *> free_;
+};
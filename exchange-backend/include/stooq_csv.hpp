@@ -0,0 +1,131 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// One data row of a Stooq quote CSV (Symbol,Date,Time,Open,High,Low,Close,Volume).
+// `symbol` points into the parsed body; missing values ("N/D") read as 0.
+struct stooq_row
+{
+    std::string_view symbol;
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double close = 0;
+    double volume = 0;
+};
+
+namespace stooq_csv_detail
+{
+    // First ',' or '\n' in [p, end), or end. Scans 16 bytes per step where SIMD is available.
+    inline const char *find_delim(const char *p, const char *end)
+    {
+#if defined(__SSE2__)
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i nl = _mm_set1_epi8('\n');
+        while (end - p >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, nl)));
+            if (mask)
+                return p + __builtin_ctz(static_cast<unsigned>(mask));
+            p += 16;
+        }
+#elif defined(__ARM_NEON)
+        const uint8x16_t comma = vdupq_n_u8(',');
+        const uint8x16_t nl = vdupq_n_u8('\n');
+        while (end - p >= 16)
+        {
+            uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+            uint8x16_t eq = vorrq_u8(vceqq_u8(chunk, comma), vceqq_u8(chunk, nl));
+            // narrow each byte to a nibble so the match mask fits in 64 bits
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+            if (mask)
+                return p + (__builtin_ctzll(mask) >> 2);
+            p += 16;
+        }
+#endif
+        while (p < end && *p != ',' && *p != '\n')
+            ++p;
+        return p;
+    }
+
+    inline double to_double(std::string_view s)
+    {
+        double v = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        if (std::from_chars(s.data(), s.data() + s.size(), v).ec != std::errc())
+            return 0;
+#else
+        // no floating-point from_chars in this standard library; strtod needs a terminated copy
+        char buf[64];
+        if (s.size() >= sizeof(buf))
+            return 0;
+        std::memcpy(buf, s.data(), s.size());
+        buf[s.size()] = '\0';
+        v = std::strtod(buf, nullptr);
+#endif
+        return v;
+    }
+}
+
+// Parses a Stooq quote CSV body, skipping the header line, and calls `on_row(const stooq_row &)`
+// for every row with at least 8 columns. Works in place on `body` without allocating.
+// Returns the number of rows delivered.
+template <class OnRow>
+std::size_t parse_stooq_csv(std::string_view body, OnRow &&on_row)
+{
+    using stooq_csv_detail::find_delim;
+    using stooq_csv_detail::to_double;
+    const char *p = body.data();
+    const char *end = p + body.size();
+    bool header = true;
+    std::size_t rows = 0;
+    while (p < end)
+    {
+        std::string_view cols[8];
+        std::size_t n = 0;
+        for (;;)
+        {
+            const char *d = find_delim(p, end);
+            if (n < 8)
+                cols[n] = std::string_view(p, static_cast<std::size_t>(d - p));
+            ++n;
+            bool eol = d == end || *d == '\n';
+            p = d == end ? end : d + 1;
+            if (eol)
+                break;
+        }
+        std::string_view &last = cols[(n < 8 ? n : 8) - 1];
+        if (n <= 8 && !last.empty() && last.back() == '\r')
+            last.remove_suffix(1);
+        if (n == 1 && cols[0].empty())
+            continue; // blank line
+        if (header)
+        {
+            header = false;
+            continue;
+        }
+        if (n < 8)
+            continue;
+        stooq_row row;
+        row.symbol = cols[0];
+        row.open = to_double(cols[3]);
+        row.high = to_double(cols[4]);
+        row.low = to_double(cols[5]);
+        row.close = to_double(cols[6]);
+        row.volume = to_double(cols[7]);
+        on_row(row);
+        ++rows;
+    }
+    return rows;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <boost/beast/http.hpp>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+
+// Where an upstream request goes. Connections are pooled per distinct endpoint.
+struct upstream_endpoint
+{
+    std::string scheme = "https"; // "http" or "https"
+    std::string host;
+    std::string port;             // empty: 80 for http, 443 for https
+    bool verify_peer = true;      // https only
+};
+
+// Async HTTP(S) client for the quote providers. Keeps idle keep-alive connections per endpoint,
+// caches DNS answers and resumes TLS sessions, so a refresh mostly skips connection setup.
+// Requests run on the client's own io threads; callers block on the returned future if they like.
+class upstream_client
+{
+public:
+    explicit upstream_client(std::size_t threads = 1);
+    ~upstream_client();
+
+    upstream_client(const upstream_client &) = delete;
+    upstream_client &operator=(const upstream_client &) = delete;
+
+    // GET `target` from `ep`. `headers` are sent as given; Host is filled in when absent.
+    // The future throws boost::system::system_error on connect/TLS/IO failure or timeout.
+    std::future<boost::beast::http::response<boost::beast::http::string_body>>
+    async_get(const upstream_endpoint &ep, std::string target, boost::beast::http::fields headers = {});
+
+    boost::beast::http::response<boost::beast::http::string_body>
+    get(const upstream_endpoint &ep, std::string target, boost::beast::http::fields headers = {})
+    {
+        return async_get(ep, std::move(target), std::move(headers)).get();
+    }
+
+private:
+    struct impl;
+    struct op;
+    std::unique_ptr<impl> impl_;
+};
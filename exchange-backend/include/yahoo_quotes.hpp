@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The fields fetch_once uses from one entry of Yahoo's quoteResponse.result.
+struct yahoo_quote
+{
+    std::string symbol;
+    std::string short_name;
+    double price = 0;   // regularMarketPrice
+    double change = 0;  // regularMarketChange
+    double percent = 0; // regularMarketChangePercent
+};
+
+// Streams a /v7/finance/quote response through a SAX handler and keeps only the fields above,
+// without building a DOM. Missing fields keep their defaults. Throws std::runtime_error on bad JSON.
+std::vector<yahoo_quote> parse_yahoo_quotes(std::string_view body);
@@ -0,0 +1,194 @@
+#include "json_writer.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    // Key fragments including the separators around them, so each field costs one append.
+    constexpr std::string_view quote_key_change = "{\"change\":";
+    constexpr std::string_view quote_key_name = ",\"name\":";
+    constexpr std::string_view quote_key_percent = ",\"percent\":";
+    constexpr std::string_view quote_key_price = ",\"price\":";
+    constexpr std::string_view quote_key_symbol = ",\"symbol\":";
+
+    constexpr std::string_view order_key_amount = "{\"amount\":";
+    constexpr std::string_view order_key_created_at = ",\"created_at\":";
+    constexpr std::string_view order_key_id = ",\"id\":";
+    constexpr std::string_view order_key_price = ",\"price\":";
+    constexpr std::string_view order_key_side = ",\"side\":";
+    constexpr std::string_view order_key_status = ",\"status\":";
+    constexpr std::string_view order_key_user_id = ",\"user_id\":";
+
+    constexpr std::string_view level_key_amount = "{\"amount\":";
+    constexpr std::string_view level_key_orders = ",\"orders\":";
+    constexpr std::string_view level_key_price = ",\"price\":";
+
+    void write_levels(json_writer &w, const instrument &inst, const std::vector<level_view> &levels, std::size_t depth)
+    {
+        w.raw('[');
+        for (std::size_t i = 0; i < levels.size() && i < depth; ++i)
+        {
+            if (i > 0)
+                w.raw(',');
+            w.raw(level_key_amount);
+            w.decimal(levels[i].amount.units, inst.amount_decimals);
+            w.raw(level_key_orders);
+            w.number(static_cast<std::int64_t>(levels[i].orders));
+            w.raw(level_key_price);
+            w.decimal(levels[i].price.units, inst.price_decimals);
+            w.raw('}');
+        }
+        w.raw(']');
+    }
+}
+
+void json_writer::number(double v)
+{
+    if (!std::isfinite(v))
+    {
+        out.append("null");
+        return;
+    }
+    char buf[32];
+    // integral values below 2^53 print exactly as integers; to_chars would pick 1e+08 over 100000000
+    if (v == std::trunc(v) && std::fabs(v) < 9007199254740992.0)
+    {
+        auto end = std::to_chars(buf, buf + sizeof(buf), static_cast<std::int64_t>(v)).ptr;
+        out.append(buf, end);
+        out.append(".0");
+        return;
+    }
+    auto end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+    out.append(buf, end);
+}
+
+void json_writer::number(std::int64_t v)
+{
+    char buf[24];
+    auto end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+    out.append(buf, end);
+}
+
+void json_writer::decimal(std::int64_t units, int decimals)
+{
+    char buf[32];
+    char *end = format_decimal(buf, units, decimals);
+    out.append(buf, end);
+    if (std::find(buf, end, '.') == end)
+        out.append(".0");
+}
+
+void json_writer::string(std::string_view s)
+{
+    out.push_back('"');
+    std::size_t run = 0; // start of the pending span that needs no escaping
+    for (std::size_t i = 0; i < s.size(); ++i)
+    {
+        auto c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (c)
+        {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\b':
+            out.append("\\b");
+            break;
+        case '\f':
+            out.append("\\f");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            out.append("\\u00");
+            out.push_back(hex_digits[c >> 4]);
+            out.push_back(hex_digits[c & 0xf]);
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out.push_back('"');
+}
+
+void write_quote(json_writer &w, const quote_table &t, std::size_t row)
+{
+    w.raw(quote_key_change);
+    w.number(t.change[row]);
+    w.raw(quote_key_name);
+    w.string(t.name[row]);
+    w.raw(quote_key_percent);
+    w.number(t.percent[row]);
+    w.raw(quote_key_price);
+    w.number(t.price[row]);
+    w.raw(quote_key_symbol);
+    w.string(t.symbol(row));
+    w.raw('}');
+}
+
+void write_quotes(json_writer &w, const quote_table &t)
+{
+    w.raw('[');
+    for (std::size_t row = 0; row < t.size(); ++row)
+    {
+        if (row > 0)
+            w.raw(',');
+        write_quote(w, t, row);
+    }
+    w.raw(']');
+}
+
+void write_order(json_writer &w, const instrument &inst, const order_record &o)
+{
+    w.raw(order_key_amount);
+    w.decimal(o.amount.units, inst.amount_decimals);
+    w.raw(order_key_created_at);
+    w.string(o.created_at);
+    w.raw(order_key_id);
+    w.number(static_cast<std::int64_t>(o.id));
+    w.raw(order_key_price);
+    w.decimal(o.price.units, inst.price_decimals);
+    w.raw(order_key_side);
+    w.string(o.side);
+    w.raw(order_key_status);
+    w.string(o.status);
+    w.raw(order_key_user_id);
+    w.number(static_cast<std::int64_t>(o.user_id));
+    w.raw('}');
+}
+
+void write_orders(json_writer &w, const instrument &inst, const std::vector<order_record> &orders)
+{
+    w.raw('[');
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        if (i > 0)
+            w.raw(',');
+        write_order(w, inst, orders[i]);
+    }
+    w.raw(']');
+}
+
+void write_book(json_writer &w, const instrument &inst, const std::vector<level_view> &bids, const std::vector<level_view> &asks,
+                std::size_t depth)
+{
+    w.raw("{\"asks\":");
+    write_levels(w, inst, asks, depth);
+    w.raw(",\"bids\":");
+    write_levels(w, inst, bids, depth);
+    w.raw('}');
+}
@@ -0,0 +1,82 @@
+#include "matching_engine.hpp"
+
+std::string_view to_string(order_status s)
+{
+    switch (s)
+    {
+    case order_status::open:
+        return "open";
+    case order_status::partial:
+        return "partial";
+    case order_status::filled:
+        return "filled";
+    case order_status::cancelled:
+        return "cancelled";
+    case order_status::rejected:
+        break;
+    }
+    return "rejected";
+}
+
+match_result &matching_engine::begin()
+{
+    result_.sequence = ++sequence_;
+    result_.accepted = false;
+    result_.fills.clear();
+    result_.updates.clear();
+    return result_;
+}
+
+const match_result &matching_engine::submit(const order_request &o)
+{
+    match_result &r = begin();
+    bool is_limit = o.type == order_type::limit;
+    if (o.amount <= qty_lots() || (is_limit && o.price <= price_ticks()) || book_.contains(o.id))
+    {
+        r.updates.push_back({o.id, order_status::rejected, o.amount});
+        return r;
+    }
+    std::optional<price_ticks> limit;
+    if (is_limit)
+        limit = o.price;
+    qty_lots remaining = book_.match(o.side, limit, o.amount, [&](const book_order &maker, qty_lots traded)
+                                   {
+        r.fills.push_back({o.id, o.user_id, maker.id, maker.user_id, maker.price, traded});
+        qty_lots left = maker.amount - traded;
+        r.updates.push_back({maker.id, left > qty_lots() ? order_status::partial : order_status::filled, left}); });
+    r.accepted = true;
+    if (remaining == qty_lots())
+        r.updates.push_back({o.id, order_status::filled, remaining});
+    else if (is_limit && book_.can_rest(o.side, o.price))
+    {
+        book_.add({o.id, o.user_id, o.side, o.price, remaining});
+        r.updates.push_back({o.id, r.fills.empty() ? order_status::open : order_status::partial, remaining});
+    }
+    else if (is_limit && r.fills.empty())
+    {
+        // can't rest and traded nothing, so it never touched the book
+        r.accepted = false;
+        r.updates.push_back({o.id, order_status::rejected, remaining});
+    }
+    else
+    {
+        // a market order's untraded rest, or the part of a limit order the book can't hold
+        r.updates.push_back({o.id, order_status::cancelled, remaining});
+    }
+    return r;
+}
+
+const match_result &matching_engine::cancel(int id)
+{
+    match_result &r = begin();
+    if (auto removed = book_.cancel(id))
+    {
+        r.accepted = true;
+        r.updates.push_back({id, order_status::cancelled, removed->amount});
+    }
+    else
+    {
+        r.updates.push_back({id, order_status::rejected, qty_lots()});
+    }
+    return r;
+}
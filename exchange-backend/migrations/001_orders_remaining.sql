@@ -0,0 +1,5 @@
+-- What is left of an order, kept apart from the amount it was entered with. Rows written before
+-- this column existed have it NULL and held the remaining amount in `amount`, which is what the
+-- server reads back for them. Apply once as the table owner:
+--   psql "$PG_CONNINFO" -f migrations/001_orders_remaining.sql
+ALTER TABLE orders ADD COLUMN IF NOT EXISTS remaining NUMERIC;
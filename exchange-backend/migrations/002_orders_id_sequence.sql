@@ -0,0 +1,5 @@
+-- The server now takes order ids from the orders id sequence instead of MAX(id) + 1. Ids it
+-- inserted explicitly before left the sequence behind, so move it past them. orders.id must be a
+-- serial or identity column. Apply once as the table owner:
+--   psql "$PG_CONNINFO" -f migrations/002_orders_id_sequence.sql
+SELECT setval(pg_get_serial_sequence('orders', 'id'), COALESCE((SELECT MAX(id) FROM orders), 0) + 1, false);
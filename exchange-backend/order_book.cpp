@@ -0,0 +1,163 @@
+#include "order_book.hpp"
+#include <algorithm>
+
+std::optional<order_side> parse_order_side(std::string_view s)
+{
+    if (s == "buy")
+        return order_side::buy;
+    if (s == "sell")
+        return order_side::sell;
+    return std::nullopt;
+}
+
+std::string_view to_string(order_side s)
+{
+    return s == order_side::buy ? "buy" : "sell";
+}
+
+order_book::order_book()
+{
+    bids_.bids = true;
+}
+
+bool order_book::ladder::fits(std::int64_t t) const
+{
+    if (empty())
+        return true;
+    std::int64_t lo = std::min({tick(best), tick(worst), t});
+    std::int64_t hi = std::max({tick(best), tick(worst), t});
+    return hi - lo < max_ladder_ticks;
+}
+
+std::size_t order_book::ladder::slot(std::int64_t t)
+{
+    std::int64_t size = static_cast<std::int64_t>(levels.size());
+    if (t >= base && t < base + size)
+        return static_cast<std::size_t>(t - base);
+    if (empty())
+    {
+        // nothing rests, so the array can simply be re-centred on t
+        if (levels.empty())
+        {
+            levels.resize(1024);
+            occupied.assign(levels.size());
+        }
+        base = t - static_cast<std::int64_t>(levels.size()) / 2;
+        return static_cast<std::size_t>(t - base);
+    }
+    // re-centre on the ticks that will rest once t is added, which fits(t) bounds, growing to
+    // twice that span if the array is smaller; the nodes themselves stay where they are in the pool
+    std::int64_t lo = std::min({tick(best), tick(worst), t});
+    std::int64_t hi = std::max({tick(best), tick(worst), t});
+    std::int64_t span = hi - lo + 1;
+    std::int64_t grown = std::min(std::max(span * 2, size), max_ladder_ticks * 2);
+    std::int64_t new_base = lo - (grown - span) / 2;
+    std::vector<level> moved(static_cast<std::size_t>(grown));
+    occupancy_bitmap moved_occupied;
+    moved_occupied.assign(moved.size());
+    for (std::size_t i = best; i != none; i = next_worse(i))
+    {
+        std::size_t to = static_cast<std::size_t>(tick(i) - new_base);
+        moved[to] = levels[i];
+        moved_occupied.set(to);
+    }
+    best = static_cast<std::size_t>(tick(best) - new_base);
+    worst = static_cast<std::size_t>(tick(worst) - new_base);
+    levels = std::move(moved);
+    occupied = std::move(moved_occupied);
+    base = new_base;
+    return static_cast<std::size_t>(t - base);
+}
+
+void order_book::ladder::filled(std::size_t i)
+{
+    occupied.set(i);
+    if (used++ == 0)
+    {
+        best = worst = i;
+        return;
+    }
+    if (better(i, best))
+        best = i;
+    else if (better(worst, i))
+        worst = i;
+}
+
+void order_book::ladder::emptied(std::size_t i)
+{
+    occupied.reset(i);
+    if (--used == 0)
+    {
+        best = worst = none;
+        return;
+    }
+    // the next non-empty level inward, which is at most the other end away
+    if (i == best)
+        best = next_worse(best);
+    else if (i == worst)
+        worst = bids ? occupied.next_after(worst) : occupied.prev_before(worst);
+}
+
+bool order_book::can_rest(order_side side, price_ticks price) const
+{
+    return (side == order_side::buy ? bids_ : asks_).fits(price.units);
+}
+
+bool order_book::add(const book_order &o)
+{
+    if (o.amount <= qty_lots() || contains(o.id))
+        return false;
+    ladder &side = o.side == order_side::buy ? bids_ : asks_;
+    if (!side.fits(o.price.units))
+        return false;
+    std::size_t i = side.slot(o.price.units);
+    level &l = side.levels[i];
+    if (l.empty())
+        side.filled(i);
+    order_node *node = nodes_.allocate();
+    node->order = o;
+    l.amount += o.amount;
+    l.push_back(node);
+    index_.insert(o.id, node);
+    return true;
+}
+
+std::optional<book_order> order_book::cancel(int id)
+{
+    order_node *node = index_.erase(id);
+    if (!node)
+        return std::nullopt;
+    book_order removed = node->order;
+    ladder &side = removed.side == order_side::buy ? bids_ : asks_;
+    std::size_t i = static_cast<std::size_t>(removed.price.units - side.base);
+    level &l = side.levels[i];
+    l.amount -= removed.amount;
+    l.unlink(node);
+    nodes_.release(node);
+    if (l.empty())
+        side.emptied(i);
+    return removed;
+}
+
+std::vector<level_view> order_book::view(const ladder &side, std::size_t depth) const
+{
+    std::vector<level_view> out;
+    out.reserve(std::min(depth, side.used));
+    // from best toward worst, only visiting the levels that hold orders
+    for (std::size_t i = side.best; out.size() < std::min(depth, side.used); i = side.next_worse(i))
+    {
+        const level &l = side.levels[i];
+        out.push_back({price_ticks(side.tick(i)), l.amount, l.count});
+    }
+    return out;
+}
+
+std::vector<level_view> order_book::bids(std::size_t depth) const
+{
+    return view(bids_, depth);
+}
+
+std::vector<level_view> order_book::asks(std::size_t depth) const
+{
+    return view(asks_, depth);
+}
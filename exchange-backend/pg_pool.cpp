@@ -0,0 +1,50 @@
+#include "pg_pool.hpp"
+#include <stdexcept>
+
+pg_pool::pg_pool(std::string conninfo, std::size_t size, std::function<void(pqxx::connection &)> prepare)
+    : conninfo_(std::move(conninfo)), size_(size ? size : 1), prepare_(std::move(prepare))
+{
+    idle_.reserve(size_);
+}
+
+pg_pool::lease pg_pool::acquire()
+{
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!cv_.wait_for(lock, acquire_timeout, [this]
+                          { return !idle_.empty() || open_ < size_; }))
+            throw std::runtime_error("pg_pool_timeout");
+        if (!idle_.empty())
+        {
+            auto conn = std::move(idle_.back());
+            idle_.pop_back();
+            return lease{this, std::move(conn)};
+        }
+        ++open_;
+    }
+    // connect outside the lock so a slow handshake doesn't hold up callers with idle connections to reuse
+    try
+    {
+        auto conn = std::make_unique<pqxx::connection>(conninfo_);
+        if (prepare_)
+            prepare_(*conn);
+        return lease{this, std::move(conn)};
+    }
+    catch (...)
+    {
+        release(nullptr);
+        throw;
+    }
+}
+
+void pg_pool::release(std::unique_ptr<pqxx::connection> conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (conn)
+            idle_.push_back(std::move(conn));
+        else
+            --open_;
+    }
+    cv_.notify_one();
+}
@@ -0,0 +1,49 @@
+#include "quote_table.hpp"
+
+std::shared_ptr<const symbol_table> symbol_table::with_symbols(const std::shared_ptr<const symbol_table> &base,
+                                                               const std::vector<quote> &quotes)
+{
+    static const symbol_table empty;
+    std::shared_ptr<symbol_table> extended;
+    for (const auto &q : quotes)
+    {
+        const symbol_table &current = extended ? *extended : base ? *base : empty;
+        if (current.ids_.count(q.symbol))
+            continue;
+        if (!extended)
+            extended = std::make_shared<symbol_table>(current);
+        extended->ids_.emplace(q.symbol, static_cast<std::uint32_t>(extended->symbols_.size()));
+        extended->symbols_.push_back(q.symbol);
+    }
+    if (!extended)
+        return base ? base : std::make_shared<const symbol_table>();
+    return extended;
+}
+
+quote_table quote_table::build(const std::vector<quote> &quotes, std::shared_ptr<const symbol_table> symbols)
+{
+    quote_table t;
+    t.symbols = std::move(symbols);
+    t.row_of.assign(t.symbols->size(), -1);
+    for (auto *col : {&t.price, &t.change, &t.percent, &t.open, &t.high, &t.low, &t.volume})
+        col->reserve(quotes.size());
+    t.symbol_id.reserve(quotes.size());
+    t.name.reserve(quotes.size());
+    for (const auto &q : quotes)
+    {
+        std::uint32_t id = t.symbols->find(q.symbol);
+        if (id == symbol_table::npos || t.row_of[id] >= 0)
+            continue;
+        t.row_of[id] = static_cast<std::int32_t>(t.symbol_id.size());
+        t.symbol_id.push_back(id);
+        t.name.push_back(q.name);
+        t.price.push_back(q.price);
+        t.change.push_back(q.change);
+        t.percent.push_back(q.percent);
+        t.open.push_back(q.open);
+        t.high.push_back(q.high);
+        t.low.push_back(q.low);
+        t.volume.push_back(q.volume);
+    }
+    return t;
+}
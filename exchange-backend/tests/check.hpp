@@ -0,0 +1,27 @@
+#pragma once
+
+// Just enough of a test harness for tests/: CHECK reports a failed condition with its location and
+// keeps going, and a test's main returns failures() so ctest sees the run fail.
+#include <cstdio>
+
+namespace test
+{
+    inline int failed = 0;
+
+    inline int failures()
+    {
+        if (failed)
+            std::fprintf(stderr, "%d check(s) failed\n", failed);
+        return failed ? 1 : 0;
+    }
+}
+
+#define CHECK(cond)                                                                      \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(cond))                                                                     \
+        {                                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++test::failed;                                                              \
+        }                                                                                \
+    } while (0)
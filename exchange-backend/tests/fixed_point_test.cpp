@@ -0,0 +1,144 @@
+// parse_decimal / format_decimal / decimal_from_double at their edges: the widest values that fit,
+// digits finer than the instrument, signs, stray dots, overflow, and text round trips.
+#include "check.hpp"
+#include "fixed_point.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace
+{
+    constexpr std::int64_t max_units = std::int64_t{1} << 53;
+
+    bool parses_to(std::string_view text, int decimals, std::int64_t units)
+    {
+        auto v = parse_decimal(text, decimals);
+        return v && *v == units;
+    }
+
+    bool refused(std::string_view text, int decimals)
+    {
+        return !parse_decimal(text, decimals).has_value();
+    }
+
+    void plain_values()
+    {
+        CHECK(parses_to("101.53", 2, 10153));
+        CHECK(parses_to("101.5", 2, 10150));
+        CHECK(parses_to("101", 2, 10100));
+        CHECK(parses_to("0.0001", 4, 1));
+        CHECK(parses_to("007", 0, 7));
+        CHECK(parses_to("0", 8, 0));
+    }
+
+    void widest_values()
+    {
+        // 2^53 units is the most a value may carry, at every scale
+        CHECK(parses_to("9007199254740992", 0, max_units));
+        CHECK(refused("9007199254740993", 0));
+        CHECK(parses_to("900719925474.0992", 4, max_units));
+        CHECK(refused("900719925474.0993", 4));
+        CHECK(parses_to("90071992.54740992", 8, max_units));
+        CHECK(refused("90071992.54740993", 8));
+        CHECK(parses_to("-90071992.54740992", 8, -max_units));
+        CHECK(parses_to("0.00000001", 8, 1));
+    }
+
+    void overflow()
+    {
+        // whole parts that only overflow once scaled by 10^decimals
+        CHECK(refused("5000000000000000", 4));
+        CHECK(refused("92233720368547758", 2));
+        CHECK(refused("900719925475", 4));
+        CHECK(refused("99999999999999999999999999", 0));
+        CHECK(refused("99999999999999999999999999", 8));
+        CHECK(refused("-5000000000000000", 4));
+    }
+
+    void finer_than_the_instrument()
+    {
+        CHECK(refused("1.005", 2));
+        CHECK(refused("0.00001", 4));
+        CHECK(refused("1.5", 0));
+        // trailing zeros past the last decimal change nothing
+        CHECK(parses_to("1.000000", 2, 100));
+        CHECK(parses_to("2.", 0, 2));
+        CHECK(parses_to("1.50000000000000000000", 1, 15));
+    }
+
+    void signs_and_dots()
+    {
+        CHECK(parses_to("-3", 0, -3));
+        CHECK(parses_to("-0.5", 2, -50));
+        CHECK(parses_to("-0", 2, 0));
+        CHECK(parses_to(".5", 2, 50));
+        CHECK(parses_to("-.25", 2, -25));
+        CHECK(parses_to("5.", 2, 500));
+        CHECK(refused("+5", 2));
+        CHECK(refused("--5", 2));
+        CHECK(refused("-", 2));
+        CHECK(refused(".", 2));
+        CHECK(refused("-.", 2));
+        CHECK(refused("", 2));
+        CHECK(refused("1.2.3", 2));
+        CHECK(refused("1,5", 2));
+        CHECK(refused(" 1", 2));
+        CHECK(refused("1e3", 2));
+        CHECK(refused("NaN", 2));
+        CHECK(refused("Infinity", 2));
+    }
+
+    void decimals_out_of_range()
+    {
+        CHECK(refused("1", -1));
+        CHECK(refused("1", max_decimals + 1));
+        CHECK(parses_to("1", max_decimals, 100000000));
+    }
+
+    void formatting()
+    {
+        CHECK(format_decimal(10153, 2) == "101.53");
+        CHECK(format_decimal(10150, 2) == "101.5");
+        CHECK(format_decimal(10100, 2) == "101");
+        CHECK(format_decimal(5, 2) == "0.05");
+        CHECK(format_decimal(-5, 2) == "-0.05");
+        CHECK(format_decimal(0, 4) == "0");
+        CHECK(format_decimal(1, 8) == "0.00000001");
+        CHECK(format_decimal(max_units, 8) == "90071992.54740992");
+        CHECK(format_decimal(-max_units, 0) == "-9007199254740992");
+    }
+
+    void round_trips()
+    {
+        const std::int64_t values[] = {0, 1, -1, 9, 10, 11, 99, 100, 101, 12345, -12345, 100000000, 123456789,
+                                       1000000000001, max_units - 1, max_units, -max_units};
+        for (int d = 0; d <= max_decimals; ++d)
+            for (std::int64_t u : values)
+            {
+                auto back = parse_decimal(format_decimal(u, d), d);
+                CHECK(back && *back == u);
+            }
+    }
+
+    void from_double()
+    {
+        CHECK(decimal_from_double(101.53, 2) == std::optional<std::int64_t>(10153));
+        CHECK(decimal_from_double(-0.07, 2) == std::optional<std::int64_t>(-7));
+        CHECK(!decimal_from_double(0.001, 2));
+        CHECK(!decimal_from_double(1e300, 2));
+        CHECK(decimal_to_double(10153, 2) == 101.53);
+    }
+}
+
+int main()
+{
+    plain_values();
+    widest_values();
+    overflow();
+    finer_than_the_instrument();
+    signs_and_dots();
+    decimals_out_of_range();
+    formatting();
+    round_trips();
+    from_double();
+    return test::failures();
+}
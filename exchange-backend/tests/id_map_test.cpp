@@ -0,0 +1,216 @@
+// id_map's probing and backward-shift deletion, and slab_pool's free-list reuse. The collision
+// tests pick keys by the same Fibonacci hash id_map uses, so they land in one probe run for sure.
+#include "check.hpp"
+#include "id_map.hpp"
+#include "slab_pool.hpp"
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // id_map's home slot for `key` in a table of 2^bits slots.
+    std::size_t home(int key, unsigned bits)
+    {
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(static_cast<std::uint32_t>(key)) * 0x9e3779b97f4a7c15ull) >> (64 - bits));
+    }
+
+    // The first `n` non-negative keys whose home is `slot` in a fresh (1024-slot) map.
+    std::vector<int> keys_at(std::size_t slot, std::size_t n)
+    {
+        std::vector<int> keys;
+        for (int k = 0; keys.size() < n; ++k)
+            if (home(k, 10) == slot)
+                keys.push_back(k);
+        return keys;
+    }
+
+    int values[1 << 16];
+
+    int *value(int key)
+    {
+        return &values[static_cast<std::uint32_t>(key) % (1 << 16)];
+    }
+
+    bool holds(const id_map<int> &m, int key)
+    {
+        return m.find(key) == value(key);
+    }
+
+    void colliding_keys()
+    {
+        id_map<int> m;
+        auto keys = keys_at(500, 5);
+        for (int k : keys)
+            CHECK(m.insert(k, value(k)));
+        CHECK(m.size() == 5);
+        for (int k : keys)
+            CHECK(holds(m, k));
+
+        // erase from the middle of the run: everything after it must still be reachable
+        CHECK(m.erase(keys[1]) == value(keys[1]));
+        CHECK(m.find(keys[1]) == nullptr);
+        for (int k : {keys[0], keys[2], keys[3], keys[4]})
+            CHECK(holds(m, k));
+        // then its head, then its tail
+        CHECK(m.erase(keys[0]) == value(keys[0]));
+        CHECK(m.erase(keys[4]) == value(keys[4]));
+        CHECK(holds(m, keys[2]) && holds(m, keys[3]));
+        CHECK(m.size() == 2);
+
+        // erased keys go back in, and erasing what isn't there changes nothing
+        CHECK(m.insert(keys[1], value(keys[1])));
+        CHECK(holds(m, keys[1]));
+        CHECK(m.erase(keys[0]) == nullptr);
+        CHECK(m.size() == 3);
+    }
+
+    // A run whose home is the last slot wraps to the front, where it meets keys homed at slot 0.
+    void colliding_keys_wrap_around()
+    {
+        id_map<int> m;
+        auto tail = keys_at(1023, 3);
+        auto front = keys_at(0, 2);
+        for (int k : tail)
+            m.insert(k, value(k));
+        for (int k : front)
+            m.insert(k, value(k));
+        CHECK(m.erase(tail[0]) == value(tail[0]));
+        for (int k : {tail[1], tail[2], front[0], front[1]})
+            CHECK(holds(m, k));
+        CHECK(m.erase(front[0]) == value(front[0]));
+        for (int k : {tail[1], tail[2], front[1]})
+            CHECK(holds(m, k));
+        CHECK(m.erase(tail[2]) == value(tail[2]));
+        CHECK(holds(m, tail[1]) && holds(m, front[1]));
+    }
+
+    void duplicates()
+    {
+        id_map<int> m;
+        CHECK(m.insert(7, value(7)));
+        CHECK(!m.insert(7, value(8)));
+        CHECK(m.find(7) == value(7));
+        CHECK(m.size() == 1);
+        CHECK(m.insert(-7, value(-7)));
+        CHECK(holds(m, -7) && holds(m, 7));
+    }
+
+    // Growing past half full rehashes; every key must survive it, however many times it happens.
+    void growth()
+    {
+        id_map<int> m;
+        for (int k = 1; k <= 20000; ++k)
+            CHECK(m.insert(k, value(k)));
+        CHECK(m.size() == 20000);
+        bool all = true;
+        for (int k = 1; k <= 20000; ++k)
+            all = all && holds(m, k);
+        CHECK(all);
+        CHECK(m.find(0) == nullptr && m.find(20001) == nullptr);
+
+        id_map<int> r;
+        r.reserve(5000);
+        for (int k = 0; k < 5000; ++k)
+            r.insert(k * 7, value(k * 7));
+        all = true;
+        for (int k = 0; k < 5000; ++k)
+            all = all && holds(r, k * 7);
+        CHECK(all && r.size() == 5000);
+    }
+
+    // Random inserts and erases over a small key range, so runs form and break up constantly,
+    // checked against std::unordered_map after every step.
+    void against_a_model()
+    {
+        id_map<int> m;
+        std::unordered_map<int, int *> model;
+        std::uint64_t state = 0x9e3779b97f4a7c15ull;
+        auto next = [&state](std::uint32_t bound)
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<std::uint32_t>(((state * 0x2545f4914f6cdd1dull) >> 32) % bound);
+        };
+        int mismatches = 0;
+        for (int step = 0; step < 200000; ++step)
+        {
+            int key = static_cast<int>(next(3000)) - 1000;
+            if (next(2))
+            {
+                bool fresh = model.emplace(key, value(key)).second;
+                mismatches += m.insert(key, value(key)) != fresh;
+            }
+            else
+            {
+                auto it = model.find(key);
+                int *expected = it == model.end() ? nullptr : it->second;
+                if (it != model.end())
+                    model.erase(it);
+                mismatches += m.erase(key) != expected;
+            }
+            if (step % 1000 == 0)
+                for (int k = -1000; k < 2000; ++k)
+                {
+                    auto it = model.find(k);
+                    mismatches += m.find(k) != (it == model.end() ? nullptr : it->second);
+                }
+        }
+        CHECK(mismatches == 0);
+        CHECK(m.size() == model.size());
+    }
+
+    struct node
+    {
+        int payload = 0;
+    };
+
+    void slab_reuse()
+    {
+        slab_pool<node, 4> pool;
+        CHECK(pool.capacity() == 0);
+        std::vector<node *> live;
+        for (int i = 0; i < 6; ++i)
+        {
+            live.push_back(pool.allocate());
+            live.back()->payload = i;
+        }
+        CHECK(pool.capacity() == 8);
+        CHECK(std::set<node *>(live.begin(), live.end()).size() == 6);
+
+        // released objects come back first, most recent first, before the pool grows
+        pool.release(live[2]);
+        pool.release(live[4]);
+        CHECK(pool.allocate() == live[4]);
+        CHECK(pool.allocate() == live[2]);
+        node *a = pool.allocate();
+        node *b = pool.allocate();
+        CHECK(pool.capacity() == 8);
+        CHECK(a != b && std::set<node *>(live.begin(), live.end()).count(a) == 0);
+
+        // growing never moves what is already handed out
+        pool.reserve(100);
+        CHECK(pool.capacity() >= 100);
+        bool kept = true;
+        for (int i : {0, 1, 3, 5})
+            kept = kept && live[i]->payload == i;
+        CHECK(kept);
+        // a fresh slab is handed out front to back
+        node *c = pool.allocate();
+        node *d = pool.allocate();
+        CHECK(d == c + 1);
+    }
+}
+
+int main()
+{
+    colliding_keys();
+    colliding_keys_wrap_around();
+    duplicates();
+    growth();
+    against_a_model();
+    slab_reuse();
+    return test::failures();
+}
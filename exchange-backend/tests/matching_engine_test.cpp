@@ -0,0 +1,228 @@
+// Behaviour of matching_engine and the order_book under it: priority, fills and their statuses,
+// market orders, rejections and cancels. Prices are plain ticks and amounts plain lots.
+#include "check.hpp"
+#include "matching_engine.hpp"
+
+namespace
+{
+    order_request limit(int id, order_side side, std::int64_t price, std::int64_t amount)
+    {
+        order_request o;
+        o.id = id;
+        o.user_id = id * 10;
+        o.side = side;
+        o.price = price_ticks(price);
+        o.amount = qty_lots(amount);
+        return o;
+    }
+
+    order_request market(int id, order_side side, std::int64_t amount)
+    {
+        order_request o = limit(id, side, 0, amount);
+        o.type = order_type::market;
+        return o;
+    }
+
+    const order_update *update_of(const match_result &r, int id)
+    {
+        for (const auto &u : r.updates)
+            if (u.id == id)
+                return &u;
+        return nullptr;
+    }
+
+    bool has_update(const match_result &r, int id, order_status status, std::int64_t remaining)
+    {
+        const order_update *u = update_of(r, id);
+        return u && u->status == status && u->remaining == qty_lots(remaining);
+    }
+
+    bool is_fill(const fill &f, int maker_id, std::int64_t price, std::int64_t amount)
+    {
+        return f.maker_id == maker_id && f.price == price_ticks(price) && f.amount == qty_lots(amount);
+    }
+
+    // Better prices fill first, and within a price the oldest order does.
+    void price_time_priority()
+    {
+        matching_engine e;
+        e.submit(limit(1, order_side::sell, 101, 5));
+        e.submit(limit(2, order_side::sell, 100, 5));
+        e.submit(limit(3, order_side::sell, 100, 5));
+        const match_result &r = e.submit(limit(4, order_side::buy, 101, 12));
+        CHECK(r.accepted);
+        CHECK(r.fills.size() == 3);
+        if (r.fills.size() == 3)
+        {
+            CHECK(is_fill(r.fills[0], 2, 100, 5));
+            CHECK(is_fill(r.fills[1], 3, 100, 5));
+            CHECK(is_fill(r.fills[2], 1, 101, 2));
+        }
+        CHECK(r.fills.empty() || (r.fills[0].taker_id == 4 && r.fills[0].taker_user_id == 40 && r.fills[0].maker_user_id == 20));
+        CHECK(has_update(r, 2, order_status::filled, 0));
+        CHECK(has_update(r, 3, order_status::filled, 0));
+        CHECK(has_update(r, 1, order_status::partial, 3));
+        CHECK(has_update(r, 4, order_status::filled, 0));
+        auto asks = e.book().asks();
+        CHECK(asks.size() == 1 && asks[0].price == price_ticks(101) && asks[0].amount == qty_lots(3) && asks[0].orders == 1);
+        CHECK(e.book().bids().empty());
+
+        // same on the bid side, where the highest price is best
+        e.submit(limit(5, order_side::buy, 98, 1));
+        e.submit(limit(6, order_side::buy, 99, 1));
+        e.submit(limit(7, order_side::buy, 99, 1));
+        const match_result &s = e.submit(limit(8, order_side::sell, 98, 3));
+        CHECK(s.fills.size() == 3);
+        if (s.fills.size() == 3)
+        {
+            CHECK(is_fill(s.fills[0], 6, 99, 1));
+            CHECK(is_fill(s.fills[1], 7, 99, 1));
+            CHECK(is_fill(s.fills[2], 5, 98, 1));
+        }
+    }
+
+    // A limit order never trades through its price.
+    void limit_price_bounds_matching()
+    {
+        matching_engine e;
+        e.submit(limit(1, order_side::sell, 100, 5));
+        e.submit(limit(2, order_side::sell, 102, 5));
+        const match_result &r = e.submit(limit(3, order_side::buy, 101, 8));
+        CHECK(r.fills.size() == 1 && is_fill(r.fills[0], 1, 100, 5));
+        CHECK(has_update(r, 3, order_status::partial, 3));
+        auto bids = e.book().bids();
+        CHECK(bids.size() == 1 && bids[0].price == price_ticks(101) && bids[0].amount == qty_lots(3));
+        CHECK(e.book().asks().size() == 1);
+    }
+
+    void partial_fills()
+    {
+        matching_engine e;
+        const match_result &rest = e.submit(limit(1, order_side::sell, 100, 10));
+        CHECK(rest.accepted && rest.fills.empty());
+        CHECK(has_update(rest, 1, order_status::open, 10));
+
+        const match_result &small = e.submit(limit(2, order_side::buy, 100, 4));
+        CHECK(small.fills.size() == 1 && is_fill(small.fills[0], 1, 100, 4));
+        CHECK(has_update(small, 1, order_status::partial, 6));
+        CHECK(has_update(small, 2, order_status::filled, 0));
+        CHECK(!e.book().contains(2));
+
+        const match_result &big = e.submit(limit(3, order_side::buy, 100, 10));
+        CHECK(big.fills.size() == 1 && is_fill(big.fills[0], 1, 100, 6));
+        CHECK(has_update(big, 1, order_status::filled, 0));
+        CHECK(has_update(big, 3, order_status::partial, 4));
+        CHECK(!e.book().contains(1) && e.book().contains(3));
+        CHECK(e.book().asks().empty());
+        auto bids = e.book().bids();
+        CHECK(bids.size() == 1 && bids[0].price == price_ticks(100) && bids[0].amount == qty_lots(4));
+    }
+
+    void market_remainder_is_cancelled()
+    {
+        matching_engine e;
+        e.submit(limit(1, order_side::sell, 100, 3));
+        const match_result &r = e.submit(market(2, order_side::buy, 5));
+        CHECK(r.accepted);
+        CHECK(r.fills.size() == 1 && is_fill(r.fills[0], 1, 100, 3));
+        CHECK(has_update(r, 2, order_status::cancelled, 2));
+        CHECK(!e.book().contains(2));
+        CHECK(e.book().size() == 0);
+
+        const match_result &empty = e.submit(market(3, order_side::sell, 5));
+        CHECK(empty.accepted && empty.fills.empty());
+        CHECK(has_update(empty, 3, order_status::cancelled, 5));
+        CHECK(e.book().size() == 0);
+    }
+
+    void rejections()
+    {
+        matching_engine e;
+        e.submit(limit(1, order_side::buy, 100, 5));
+        std::uint64_t before = e.sequence();
+
+        const match_result &dup = e.submit(limit(1, order_side::sell, 100, 5));
+        CHECK(!dup.accepted && dup.fills.empty());
+        CHECK(has_update(dup, 1, order_status::rejected, 5));
+        CHECK(e.sequence() == before + 1); // rejected commands still take a sequence number
+
+        const match_result &zero = e.submit(limit(2, order_side::sell, 100, 0));
+        CHECK(!zero.accepted && has_update(zero, 2, order_status::rejected, 0));
+        const match_result &negative = e.submit(limit(3, order_side::sell, 100, -1));
+        CHECK(!negative.accepted);
+        const match_result &no_price = e.submit(limit(4, order_side::sell, 0, 5));
+        CHECK(!no_price.accepted && no_price.fills.empty());
+        const match_result &below = e.submit(limit(5, order_side::sell, -100, 5));
+        CHECK(!below.accepted && below.fills.empty());
+        const match_result &market_zero = e.submit(market(6, order_side::sell, 0));
+        CHECK(!market_zero.accepted);
+
+        // none of them touched the resting bid
+        auto bids = e.book().bids();
+        CHECK(e.book().size() == 1 && bids.size() == 1 && bids[0].amount == qty_lots(5));
+    }
+
+    // A limit order too far from its own side to rest still trades; only what would rest is refused.
+    void remainder_outside_the_ladder()
+    {
+        std::int64_t far = 100 + order_book::max_ladder_ticks + 10;
+        matching_engine e;
+        e.submit(limit(1, order_side::buy, 100, 1));
+        e.submit(limit(2, order_side::sell, 105, 5));
+        CHECK(!e.book().can_rest(order_side::buy, price_ticks(far)));
+
+        const match_result &full = e.submit(limit(3, order_side::buy, far, 2));
+        CHECK(full.accepted && full.fills.size() == 1 && is_fill(full.fills[0], 2, 105, 2));
+        CHECK(has_update(full, 3, order_status::filled, 0));
+
+        const match_result &part = e.submit(limit(4, order_side::buy, far, 5));
+        CHECK(part.accepted && part.fills.size() == 1 && is_fill(part.fills[0], 2, 105, 3));
+        CHECK(has_update(part, 4, order_status::cancelled, 2));
+        CHECK(!e.book().contains(4));
+
+        const match_result &none = e.submit(limit(5, order_side::buy, far, 5));
+        CHECK(!none.accepted && none.fills.empty());
+        CHECK(has_update(none, 5, order_status::rejected, 5));
+        CHECK(e.book().size() == 1 && e.book().contains(1));
+    }
+
+    void cancel_resting()
+    {
+        matching_engine e;
+        e.submit(limit(1, order_side::sell, 100, 5));
+        e.submit(limit(2, order_side::sell, 100, 7));
+        e.submit(limit(3, order_side::buy, 100, 2)); // leaves 3 of order 1
+
+        const match_result &r = e.cancel(1);
+        CHECK(r.accepted && r.fills.empty());
+        CHECK(has_update(r, 1, order_status::cancelled, 3));
+        CHECK(!e.book().contains(1));
+        auto asks = e.book().asks();
+        CHECK(asks.size() == 1 && asks[0].amount == qty_lots(7) && asks[0].orders == 1);
+
+        const match_result &again = e.cancel(1);
+        CHECK(!again.accepted && has_update(again, 1, order_status::rejected, 0));
+        CHECK(!e.cancel(42).accepted);
+
+        // the level empties with its last order and the next taker finds nothing there
+        CHECK(e.cancel(2).accepted);
+        CHECK(e.book().asks().empty());
+        const match_result &taker = e.submit(limit(4, order_side::buy, 100, 1));
+        CHECK(taker.fills.empty() && has_update(taker, 4, order_status::open, 1));
+
+        // a cancelled id can be used again
+        CHECK(e.submit(limit(2, order_side::sell, 101, 1)).accepted);
+    }
+}
+
+int main()
+{
+    price_time_priority();
+    limit_price_bounds_matching();
+    partial_fills();
+    market_remainder_is_cancelled();
+    rejections();
+    remainder_outside_the_ladder();
+    cancel_resting();
+    return test::failures();
+}
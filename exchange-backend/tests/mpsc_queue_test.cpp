@@ -0,0 +1,91 @@
+// mpsc_queue: a full queue refuses pushes without consuming the value, and under contention from
+// several producers every item comes out exactly once, each producer's in the order it pushed them.
+#include "check.hpp"
+#include "mpsc_queue.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void full_queue()
+    {
+        mpsc_queue<std::unique_ptr<int>> q(5); // rounded up to 8
+        for (int i = 0; i < 8; ++i)
+            CHECK(q.try_push(std::make_unique<int>(i)));
+        auto extra = std::make_unique<int>(8);
+        CHECK(!q.try_push(std::move(extra)));
+        CHECK(extra && *extra == 8); // left alone by the failed push
+
+        std::unique_ptr<int> out;
+        CHECK(q.try_pop(out) && out && *out == 0);
+        CHECK(q.try_push(std::move(extra)));
+        CHECK(!q.try_push(std::make_unique<int>(9)));
+        for (int i = 1; i <= 8; ++i)
+            CHECK(q.try_pop(out) && *out == i);
+        CHECK(q.empty() && !q.try_pop(out));
+    }
+
+    struct item
+    {
+        int producer = -1;
+        int seq = 0;
+    };
+
+    // A queue much smaller than the traffic, so producers keep running into a full queue and the
+    // consumer into an empty one while they wrap around it many times.
+    void producers_under_contention()
+    {
+        constexpr int producers = 8;
+        constexpr int per_producer = 200000;
+        mpsc_queue<item> q(64);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p)
+            threads.emplace_back([&q, p]
+                                 {
+                for (int i = 0; i < per_producer; ++i)
+                {
+                    while (!q.try_push(item{p, i}))
+                        std::this_thread::yield();
+                } });
+
+        std::vector<int> next(producers, 0);
+        int received = 0;
+        int out_of_order = 0;
+        int bad_producer = 0;
+        item it;
+        while (received < producers * per_producer)
+        {
+            if (!q.try_pop(it))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            ++received;
+            if (it.producer < 0 || it.producer >= producers)
+            {
+                ++bad_producer;
+                continue;
+            }
+            if (it.seq != next[it.producer])
+                ++out_of_order;
+            next[it.producer] = it.seq + 1;
+        }
+        for (auto &t : threads)
+            t.join();
+        CHECK(bad_producer == 0);
+        CHECK(out_of_order == 0);
+        bool all = true;
+        for (int n : next)
+            all = all && n == per_producer;
+        CHECK(all);
+        CHECK(q.empty() && !q.try_pop(it)); // nothing extra, nothing twice
+    }
+}
+
+int main()
+{
+    full_queue();
+    producers_under_contention();
+    return test::failures();
+}
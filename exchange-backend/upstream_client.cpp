@@ -0,0 +1,326 @@
+#include "upstream_client.hpp"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/ssl.hpp>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using tcp = boost::asio::ip::tcp;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+namespace
+{
+    constexpr auto io_timeout = std::chrono::seconds(15);
+    // servers usually drop idle keep-alive sockets well before this; don't hand out anything older
+    constexpr auto idle_timeout = std::chrono::seconds(30);
+    constexpr auto dns_ttl = std::chrono::minutes(5);
+    constexpr std::size_t max_idle_per_endpoint = 8;
+    constexpr std::uint64_t body_limit = 64 * 1024 * 1024;
+
+    struct upstream_connection
+    {
+        std::unique_ptr<beast::tcp_stream> plain;
+        std::unique_ptr<beast::ssl_stream<beast::tcp_stream>> tls;
+        beast::flat_buffer buffer;
+        std::chrono::steady_clock::time_point idle_since;
+        bool reused = false;
+
+        beast::tcp_stream &lowest()
+        {
+            return tls ? beast::get_lowest_layer(*tls) : *plain;
+        }
+
+        template <class F>
+        void with_stream(F &&f)
+        {
+            if (tls)
+                f(*tls);
+            else
+                f(*plain);
+        }
+    };
+
+    std::string default_port(const upstream_endpoint &ep)
+    {
+        if (!ep.port.empty())
+            return ep.port;
+        return ep.scheme == "https" ? "443" : "80";
+    }
+
+    std::string pool_key(const upstream_endpoint &ep)
+    {
+        return ep.scheme + "://" + ep.host + ":" + default_port(ep) + (ep.verify_peer ? "" : "#insecure");
+    }
+}
+
+struct upstream_client::impl
+{
+    net::io_context ioc;
+    net::executor_work_guard<net::io_context::executor_type> work{ioc.get_executor()};
+    std::vector<std::thread> threads;
+    net::ssl::context verified_ctx{net::ssl::context::tls_client};
+    net::ssl::context insecure_ctx{net::ssl::context::tls_client};
+
+    std::mutex mtx; // guards the three caches below
+    std::unordered_map<std::string, std::vector<std::unique_ptr<upstream_connection>>> idle;
+    std::unordered_map<std::string, std::pair<tcp::resolver::results_type, std::chrono::steady_clock::time_point>> dns;
+    std::unordered_map<std::string, SSL_SESSION *> sessions;
+
+    ~impl()
+    {
+        for (auto &kv : sessions)
+            SSL_SESSION_free(kv.second);
+    }
+
+    std::unique_ptr<upstream_connection> acquire(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = idle.find(key);
+        if (it == idle.end())
+            return nullptr;
+        auto now = std::chrono::steady_clock::now();
+        while (!it->second.empty())
+        {
+            auto conn = std::move(it->second.back());
+            it->second.pop_back();
+            if (now - conn->idle_since < idle_timeout)
+            {
+                conn->reused = true;
+                return conn;
+            }
+        }
+        return nullptr;
+    }
+
+    void release(const std::string &key, std::unique_ptr<upstream_connection> conn)
+    {
+        conn->idle_since = std::chrono::steady_clock::now();
+        conn->lowest().expires_never();
+        std::lock_guard<std::mutex> lk(mtx);
+        auto &list = idle[key];
+        if (list.size() < max_idle_per_endpoint)
+            list.push_back(std::move(conn));
+    }
+
+    std::optional<tcp::resolver::results_type> cached_dns(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = dns.find(key);
+        if (it == dns.end() || std::chrono::steady_clock::now() - it->second.second > dns_ttl)
+            return std::nullopt;
+        return it->second.first;
+    }
+
+    void store_dns(const std::string &key, const tcp::resolver::results_type &results)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        dns[key] = {results, std::chrono::steady_clock::now()};
+    }
+
+    void forget_dns(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        dns.erase(key);
+    }
+
+    // Returns a new reference the caller must free, or null.
+    SSL_SESSION *load_session(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = sessions.find(key);
+        if (it == sessions.end())
+            return nullptr;
+        SSL_SESSION_up_ref(it->second);
+        return it->second;
+    }
+
+    // Takes ownership of `session`.
+    void store_session(const std::string &key, SSL_SESSION *session)
+    {
+        if (!session)
+            return;
+        if (!SSL_SESSION_is_resumable(session))
+        {
+            SSL_SESSION_free(session);
+            return;
+        }
+        std::lock_guard<std::mutex> lk(mtx);
+        auto &slot = sessions[key];
+        if (slot)
+            SSL_SESSION_free(slot);
+        slot = session;
+    }
+};
+
+// One GET from acquire/connect through the response; retries once on a fresh connection when a
+// pooled one turns out to have been closed by the server.
+struct upstream_client::op : std::enable_shared_from_this<upstream_client::op>
+{
+    impl &client;
+    upstream_endpoint ep;
+    std::string key;
+    std::string dns_key;
+    http::request<http::empty_body> req;
+    std::promise<http::response<http::string_body>> promise;
+    std::unique_ptr<upstream_connection> conn;
+    std::optional<tcp::resolver> resolver;
+    std::optional<http::response_parser<http::string_body>> parser;
+    bool retried = false;
+
+    op(impl &c, upstream_endpoint e) : client(c), ep(std::move(e)), key(pool_key(ep)), dns_key(ep.host + ":" + default_port(ep)) {}
+
+    void start()
+    {
+        conn = client.acquire(key);
+        if (conn)
+            return send();
+        connect();
+    }
+
+    void connect()
+    {
+        if (auto cached = client.cached_dns(dns_key))
+            return on_resolve({}, *cached);
+        resolver.emplace(client.ioc);
+        resolver->async_resolve(ep.host, default_port(ep), beast::bind_front_handler(&op::on_resolve, shared_from_this()));
+    }
+
+    void on_resolve(beast::error_code ec, tcp::resolver::results_type results)
+    {
+        if (ec)
+            return fail(ec);
+        client.store_dns(dns_key, results);
+        conn = std::make_unique<upstream_connection>();
+        if (ep.scheme == "https")
+            conn->tls = std::make_unique<beast::ssl_stream<beast::tcp_stream>>(client.ioc, ep.verify_peer ? client.verified_ctx : client.insecure_ctx);
+        else
+            conn->plain = std::make_unique<beast::tcp_stream>(client.ioc);
+        conn->lowest().expires_after(io_timeout);
+        conn->lowest().async_connect(results, beast::bind_front_handler(&op::on_connect, shared_from_this()));
+    }
+
+    void on_connect(beast::error_code ec, tcp::endpoint)
+    {
+        if (ec)
+        {
+            // the cached address may have moved; resolve again next time
+            client.forget_dns(dns_key);
+            return fail(ec);
+        }
+        if (!conn->tls)
+            return send();
+        SSL *ssl = conn->tls->native_handle();
+        if (!SSL_set_tlsext_host_name(ssl, ep.host.c_str()))
+            return fail(beast::error_code(static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()));
+        if (ep.verify_peer)
+            conn->tls->set_verify_callback(net::ssl::host_name_verification(ep.host));
+        if (SSL_SESSION *session = client.load_session(key))
+        {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+        conn->lowest().expires_after(io_timeout);
+        conn->tls->async_handshake(net::ssl::stream_base::client, beast::bind_front_handler(&op::on_handshake, shared_from_this()));
+    }
+
+    void on_handshake(beast::error_code ec)
+    {
+        if (ec)
+            return fail(ec);
+        send();
+    }
+
+    void send()
+    {
+        parser.emplace();
+        parser->body_limit(body_limit);
+        conn->lowest().expires_after(io_timeout);
+        conn->with_stream([this](auto &stream)
+                          { http::async_write(stream, req, beast::bind_front_handler(&op::on_write, shared_from_this())); });
+    }
+
+    void on_write(beast::error_code ec, std::size_t)
+    {
+        if (ec)
+            return retry_or_fail(ec);
+        conn->with_stream([this](auto &stream)
+                          { http::async_read(stream, conn->buffer, *parser, beast::bind_front_handler(&op::on_read, shared_from_this())); });
+    }
+
+    void on_read(beast::error_code ec, std::size_t)
+    {
+        if (ec)
+            return retry_or_fail(ec);
+        auto res = parser->release();
+        if (conn->tls)
+            client.store_session(key, SSL_get1_session(conn->tls->native_handle()));
+        if (res.keep_alive())
+            client.release(key, std::move(conn));
+        promise.set_value(std::move(res));
+    }
+
+    void retry_or_fail(beast::error_code ec)
+    {
+        // a pooled socket the server already closed shows up as an error on first use
+        if (conn && conn->reused && !retried)
+        {
+            retried = true;
+            conn.reset();
+            return connect();
+        }
+        fail(ec);
+    }
+
+    void fail(beast::error_code ec)
+    {
+        promise.set_exception(std::make_exception_ptr(boost::system::system_error(ec, ep.host)));
+    }
+};
+
+upstream_client::upstream_client(std::size_t threads) : impl_(std::make_unique<impl>())
+{
+    impl_->verified_ctx.set_default_verify_paths();
+    impl_->verified_ctx.set_verify_mode(net::ssl::verify_peer);
+    impl_->insecure_ctx.set_verify_mode(net::ssl::verify_none);
+    for (auto *ctx : {&impl_->verified_ctx, &impl_->insecure_ctx})
+        SSL_CTX_set_session_cache_mode(ctx->native_handle(), SSL_SESS_CACHE_CLIENT);
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, threads); ++i)
+        impl_->threads.emplace_back([this]
+                                    { impl_->ioc.run(); });
+}
+
+upstream_client::~upstream_client()
+{
+    impl_->work.reset();
+    impl_->ioc.stop();
+    for (auto &t : impl_->threads)
+        t.join();
+}
+
+std::future<http::response<http::string_body>>
+upstream_client::async_get(const upstream_endpoint &ep, std::string target, http::fields headers)
+{
+    auto o = std::make_shared<op>(*impl_, ep);
+    o->req.method(http::verb::get);
+    o->req.target(target);
+    o->req.version(11);
+    for (const auto &field : headers)
+        o->req.insert(field.name_string(), field.value());
+    if (o->req.find(http::field::host) == o->req.end())
+        o->req.set(http::field::host, ep.port.empty() ? ep.host : ep.host + ":" + ep.port);
+    auto fut = o->promise.get_future();
+    net::post(impl_->ioc, [o]
+              { o->start(); });
+    return fut;
+}
@@ -0,0 +1,165 @@
+#include "yahoo_quotes.hpp"
+#include "json.hpp"
+#include <stdexcept>
+
+namespace
+{
+    enum class quote_field
+    {
+        none,
+        symbol,
+        short_name,
+        price,
+        change,
+        percent
+    };
+
+    quote_field field_for(const std::string &key)
+    {
+        if (key == "symbol")
+            return quote_field::symbol;
+        if (key == "shortName")
+            return quote_field::short_name;
+        if (key == "regularMarketPrice")
+            return quote_field::price;
+        if (key == "regularMarketChange")
+            return quote_field::change;
+        if (key == "regularMarketChangePercent")
+            return quote_field::percent;
+        return quote_field::none;
+    }
+
+    // Follows the path quoteResponse.result[*].<field>; everything else is skipped as it streams by.
+    // depth counts open objects/arrays: 1 = root, 2 = quoteResponse, 3 = result, 4 = one quote.
+    class quote_sax : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        std::vector<yahoo_quote> quotes;
+        std::string error;
+
+        bool null() override
+        {
+            return true;
+        }
+
+        bool boolean(bool) override
+        {
+            return true;
+        }
+
+        bool number_integer(number_integer_t v) override
+        {
+            return number(static_cast<double>(v));
+        }
+
+        bool number_unsigned(number_unsigned_t v) override
+        {
+            return number(static_cast<double>(v));
+        }
+
+        bool number_float(number_float_t v, const string_t &) override
+        {
+            return number(v);
+        }
+
+        bool string(string_t &v) override
+        {
+            if (!in_quote())
+                return true;
+            if (field_ == quote_field::symbol)
+                quotes.back().symbol = std::move(v);
+            else if (field_ == quote_field::short_name)
+                quotes.back().short_name = std::move(v);
+            return true;
+        }
+
+        bool binary(binary_t &) override
+        {
+            return true;
+        }
+
+        bool start_object(std::size_t) override
+        {
+            ++depth_;
+            if (depth_ == 4 && in_result_)
+                quotes.emplace_back();
+            return true;
+        }
+
+        bool end_object() override
+        {
+            --depth_;
+            if (depth_ == 1)
+                in_quote_response_ = false;
+            return true;
+        }
+
+        bool start_array(std::size_t) override
+        {
+            ++depth_;
+            // the result array sits at depth 3 under quoteResponse.result
+            if (depth_ == 3 && in_quote_response_ && key_is_result_)
+                in_result_ = true;
+            return true;
+        }
+
+        bool end_array() override
+        {
+            if (depth_ == 3)
+                in_result_ = false;
+            --depth_;
+            return true;
+        }
+
+        bool key(string_t &k) override
+        {
+            if (depth_ == 1)
+                in_quote_response_ = k == "quoteResponse";
+            else if (depth_ == 2)
+                key_is_result_ = k == "result";
+            else if (depth_ == 4)
+                field_ = field_for(k);
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+        {
+            error = ex.what();
+            return false;
+        }
+
+    private:
+        int depth_ = 0;
+        bool in_quote_response_ = false;
+        bool key_is_result_ = false;
+        bool in_result_ = false;
+        quote_field field_ = quote_field::none;
+
+        // a scalar directly inside one quote object (nested objects under a quote are depth 5+)
+        bool in_quote() const
+        {
+            return in_result_ && depth_ == 4 && !quotes.empty();
+        }
+
+        bool number(double v)
+        {
+            if (!in_quote())
+                return true;
+            if (field_ == quote_field::price)
+                quotes.back().price = v;
+            else if (field_ == quote_field::change)
+                quotes.back().change = v;
+            else if (field_ == quote_field::percent)
+                quotes.back().percent = v;
+            return true;
+        }
+    };
+}
+
+std::vector<yahoo_quote> parse_yahoo_quotes(std::string_view body)
+{
+    quote_sax sax;
+    if (!nlohmann::json::sax_parse(body.begin(), body.end(), &sax))
+        throw std::runtime_error("yahoo: invalid JSON: " + sax.error);
+    return std::move(sax.quotes);
+}
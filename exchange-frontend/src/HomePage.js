@@ -16,7 +16,7 @@ export default function HomePage() {
 	const [error, setError] = useState(null);
 
 	useEffect(() => {
-		fetch('http://localhost:8080/orderbook')
+		fetch('http://localhost:8080/orders')
 			.then(res => {
 				if (!res.ok) throw new Error('Failed to fetch orderbook');
 				return res.json();
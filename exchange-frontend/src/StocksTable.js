@@ -10,6 +10,30 @@ const columns = [
   { id: 'percent', label: 'Change (%)' },
 ];
 
+const STOCKS_URL = 'http://localhost:8080/stocks';
+const STOCKS_WS_URL = 'ws://localhost:8080/ws/stocks';
+const RECONNECT_MS = 5000;
+
+// Merges a {changes, removed} push into the current rows, keeping row order stable
+function applyDelta(rows, delta) {
+  const removed = new Set(delta.removed);
+  const changes = new Map(delta.changes.map(c => [c.symbol, c]));
+  const next = [];
+  for (const row of rows) {
+    if (removed.has(row.symbol)) continue;
+    const change = changes.get(row.symbol);
+    if (change) {
+      next.push({ ...row, ...change });
+      changes.delete(row.symbol);
+    } else {
+      next.push(row);
+    }
+  }
+  // whatever is left are symbols the client hasn't seen yet
+  for (const added of changes.values()) next.push(added);
+  return next;
+}
+
 export default function StocksTable() {
   const [stocks, setStocks] = useState([]);
   const [loading, setLoading] = useState(true);
@@ -18,16 +42,16 @@ export default function StocksTable() {
   const [lastUpdated, setLastUpdated] = useState(null);
   const [stale, setStale] = useState(false);
   const [provider, setProvider] = useState(null);
-  const [refreshInterval, setRefreshInterval] = useState(15000); // ms
   const [backendRefreshSeconds, setBackendRefreshSeconds] = useState(null);
-  const timerRef = useRef(null);
   const countdownRef = useRef(null);
+  const lastPushRef = useRef(null);
   const [nextUpdateIn, setNextUpdateIn] = useState(null);
 
+  // One-off HTTP fetch, used for the manual refresh button
   const fetchStocks = useCallback(async (showSpinner = false) => {
     try {
       if (showSpinner) setRefreshing(true);
-      const res = await fetch('http://localhost:8080/stocks');
+      const res = await fetch(STOCKS_URL);
       const text = await res.text();
       if (!res.ok) {
         try {
@@ -42,7 +66,6 @@ export default function StocksTable() {
       setError(null);
       setLastUpdated(new Date());
       // headers
-      const age = res.headers.get('X-Data-Age-Seconds');
       const staleHeader = res.headers.get('X-Data-Stale');
       const providerHeader = res.headers.get('X-Data-Provider');
       const refreshSecondsHeader = res.headers.get('X-Data-Refresh-Seconds');
@@ -51,49 +74,72 @@ export default function StocksTable() {
       if (refreshSecondsHeader && !isNaN(Number(refreshSecondsHeader))) {
         setBackendRefreshSeconds(Number(refreshSecondsHeader));
       }
-      setNextUpdateIn(backendRefreshSeconds ? backendRefreshSeconds : null);
     } catch (e) {
       setError(e.message);
     } finally {
-      if (loading) setLoading(false);
+      setLoading(false);
       setRefreshing(false);
     }
-  }, [loading, backendRefreshSeconds]);
+  }, []);
 
-  // Adjust polling interval to backend if available
+  // Live updates: the backend pushes a full snapshot on connect, then only the rows that changed
   useEffect(() => {
-    if (backendRefreshSeconds) {
-      const newMs = Math.max(backendRefreshSeconds * 1000, 5000); // lower bound 5s
-      if (newMs !== refreshInterval) {
-        setRefreshInterval(newMs);
-        if (timerRef.current) clearInterval(timerRef.current);
-        timerRef.current = setInterval(() => fetchStocks(), newMs);
-      }
-    }
-  }, [backendRefreshSeconds, fetchStocks, refreshInterval]);
+    let ws = null;
+    let reconnectTimer = null;
+    let closed = false;
 
-  useEffect(() => {
-    fetchStocks();
-    if (!timerRef.current) {
-      timerRef.current = setInterval(() => fetchStocks(), refreshInterval);
-    }
+    const connect = () => {
+      ws = new WebSocket(STOCKS_WS_URL);
+      ws.onmessage = (ev) => {
+        let msg;
+        try {
+          msg = JSON.parse(ev.data);
+        } catch {
+          return;
+        }
+        if (msg.type === 'snapshot') {
+          setStocks(msg.data);
+        } else if (msg.type === 'delta') {
+          setStocks(prev => applyDelta(prev, msg));
+        } else {
+          return;
+        }
+        setError(null);
+        setLoading(false);
+        setStale(false);
+        setLastUpdated(new Date());
+        lastPushRef.current = Date.now();
+        if (msg.provider) setProvider(msg.provider);
+        if (msg.refresh_seconds) {
+          setBackendRefreshSeconds(msg.refresh_seconds);
+          setNextUpdateIn(msg.refresh_seconds);
+        }
+      };
+      ws.onclose = () => {
+        if (closed) return;
+        // fall back to a plain fetch so the table isn't empty while we reconnect
+        fetchStocks();
+        reconnectTimer = setTimeout(connect, RECONNECT_MS);
+      };
+    };
+
+    connect();
     return () => {
-      if (timerRef.current) clearInterval(timerRef.current);
-      if (countdownRef.current) clearInterval(countdownRef.current);
+      closed = true;
+      if (reconnectTimer) clearTimeout(reconnectTimer);
+      if (ws) ws.close();
     };
-  }, [fetchStocks, refreshInterval]);
+  }, [fetchStocks]);
 
-  // Countdown timer for next update (frontend poll) when backend interval known
+  // Countdown to the next expected push; flags data as stale when pushes stop arriving
   useEffect(() => {
     if (!backendRefreshSeconds) return;
     if (countdownRef.current) clearInterval(countdownRef.current);
-    setNextUpdateIn(backendRefreshSeconds);
     countdownRef.current = setInterval(() => {
-      setNextUpdateIn(prev => {
-        if (prev === null) return null;
-        if (prev <= 1) return backendRefreshSeconds; // reset after polling fires
-        return prev - 1;
-      });
+      setNextUpdateIn(prev => (prev === null || prev <= 1 ? backendRefreshSeconds : prev - 1));
+      if (lastPushRef.current && Date.now() - lastPushRef.current > backendRefreshSeconds * 2000) {
+        setStale(true);
+      }
     }, 1000);
     return () => { if (countdownRef.current) clearInterval(countdownRef.current); };
   }, [backendRefreshSeconds]);
@@ -125,7 +171,7 @@ export default function StocksTable() {
           ) }
           { backendRefreshSeconds && (
             <Typography variant="caption" sx={{ color: '#666' }}>
-              Next poll in {nextUpdateIn ?? '-'}s
+              Next update in {nextUpdateIn ?? '-'}s
             </Typography>
           ) }
           <Tooltip title="Refresh now">